@@ -1,17 +1,27 @@
 #include "NBT_Lib.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NBT_LIB_SSE2
+#endif
+
 namespace NBT_Lib {
 	Compound_Tag parseNBT(void* dataPtr, size_t dataSize, std::pmr::memory_resource* memRes) {
 		size_t dataRead{ 0u };
 		byte* data{ reinterpret_cast<byte*>(dataPtr) };
 
+		if (dataSize < sizeof(int8_t) + sizeof(int16_t))
+			throw std::out_of_range("Data ran out while reading the header of the root tag.");
+
 		if (data[0] != static_cast<byte>(TagID::Compound))
 			throw std::runtime_error("Root tag must be TAG_Compound, but it was " + TagIDToString(static_cast<TagID>(data[0])));
 
-		int16_t namelength;
-		memcpy(&namelength, data+sizeof(int8_t), sizeof(int16_t));
-		data += sizeof(int8_t) + sizeof(int16_t) + size_t(namelength);
+		const size_t namelength{ copyAndFlipBytes<uint16_t>(data + sizeof(int8_t)) };
+		const size_t headerSize{ sizeof(int8_t) + sizeof(int16_t) + namelength };
+		if (dataSize < headerSize)
+			throw std::out_of_range("Data ran out while reading the name of the root tag.");
+		data += headerSize;
 
-		return Compound_Tag::fromRawData(std::pmr::string("", memRes), data, dataSize, dataRead, memRes);
+		return Compound_Tag::fromRawData({}, data, dataSize - headerSize, dataRead, memRes);
 	}
 
 	std::vector<byte> buildBinaryNBTFile(const Compound_Tag* root) {
@@ -22,7 +32,31 @@ namespace NBT_Lib {
 		return bstream.getData();
 	}
 
-	NBT_TagBase* constructNewTag(TagID id, const decltype(NBT_TagBase::name)& name, byte* dataPtr, size_t maxReadLength, size_t& out_bytesRead, std::pmr::memory_resource* memRes) {
+	void buildBinaryNBTFile(const Compound_Tag* root, std::vector<byte>& out) {
+		BinaryStream bstream(out);
+		root->addTagHeaderToBinaryStream(bstream);
+		root->addTagToBinaryStream(bstream);
+	}
+
+	//Parses a tag directly into memory allocated from memRes, the memory is returned if parsing throws.
+	template<typename tagType>
+	inline NBT_TagBase* constructFromRawData(std::string_view name, byte* dataPtr, size_t maxReadLength, size_t& out_bytesRead, std::pmr::memory_resource* memRes, size_t depth) {
+		tagType* tagPtr{ allocateMemory<tagType>(memRes) };
+		try {
+			if constexpr (std::is_same_v<tagType, List_Tag> || std::is_same_v<tagType, Compound_Tag>)
+				new(tagPtr) tagType(tagType::fromRawData(name, dataPtr, maxReadLength, out_bytesRead, memRes, depth));
+			else
+				new(tagPtr) tagType(tagType::fromRawData(name, dataPtr, maxReadLength, out_bytesRead, memRes));
+		}
+		catch (...) {
+			memRes->deallocate(tagPtr, sizeof(tagType), alignof(tagType));
+			throw;
+		}
+		return static_cast<NBT_TagBase*>(tagPtr);
+	}
+
+	//depth is the nesting depth of the new tag, only lists and compounds make use of it.
+	NBT_TagBase* constructNewTag(TagID id, std::string_view name, byte* dataPtr, size_t maxReadLength, size_t& out_bytesRead, std::pmr::memory_resource* memRes, size_t depth) {
 		switch (id) {
 			using enum TagID;
 		case End: {
@@ -30,66 +64,30 @@ namespace NBT_Lib {
 			new(tagPtr) End_Tag{ memRes };
 			return static_cast<NBT_TagBase*>(tagPtr);
 		}
-		case Byte: {
-			auto tagPtr = allocateMemory<Byte_Tag>(memRes);
-			new(tagPtr) Byte_Tag(Byte_Tag::fromRawData(name, dataPtr, maxReadLength, out_bytesRead, memRes));
-			return static_cast<NBT_TagBase*>(tagPtr);
-		}
-		case Short: {
-			auto tagPtr = allocateMemory<Short_Tag>(memRes);
-			new(tagPtr) Short_Tag(Short_Tag::fromRawData(name, dataPtr, maxReadLength, out_bytesRead, memRes));
-			return static_cast<NBT_TagBase*>(tagPtr);
-		}
-		case Int: {
-			auto tagPtr = allocateMemory<Int_Tag>(memRes);
-			new(tagPtr) Int_Tag(Int_Tag::fromRawData(name, dataPtr, maxReadLength, out_bytesRead, memRes));
-			return static_cast<NBT_TagBase*>(tagPtr);
-		}
-		case Long: {
-			auto tagPtr = allocateMemory<Long_Tag>(memRes);
-			new(tagPtr) Long_Tag(Long_Tag::fromRawData(name, dataPtr, maxReadLength, out_bytesRead, memRes));
-			return static_cast<NBT_TagBase*>(tagPtr);
-		}
-		case Float: {
-			auto tagPtr = allocateMemory<Float_Tag>(memRes);
-			new(tagPtr) Float_Tag(Float_Tag::fromRawData(name, dataPtr, maxReadLength, out_bytesRead, memRes));
-			return static_cast<NBT_TagBase*>(tagPtr);
-		}
-		case Double: {
-			auto tagPtr = allocateMemory<Double_Tag>(memRes);
-			new(tagPtr) Double_Tag(Double_Tag::fromRawData(name, dataPtr, maxReadLength, out_bytesRead, memRes));
-			return static_cast<NBT_TagBase*>(tagPtr);
-		}
-		case Byte_Array: {
-			auto tagPtr = allocateMemory<ByteArray_Tag>(memRes);
-			new(tagPtr) ByteArray_Tag(ByteArray_Tag::fromRawData(name, dataPtr, maxReadLength, out_bytesRead, memRes));
-			return static_cast<NBT_TagBase*>(tagPtr);
-		}
-		case String: {
-			auto tagPtr = allocateMemory<String_Tag>(memRes);
-			new(tagPtr) String_Tag(String_Tag::fromRawData(name, dataPtr, maxReadLength, out_bytesRead, memRes));
-			return static_cast<NBT_TagBase*>(tagPtr);
-		}
-		case List: {
-			auto tagPtr = allocateMemory<List_Tag>(memRes);
-			new(tagPtr) List_Tag(List_Tag::fromRawData(name, dataPtr, maxReadLength, out_bytesRead, memRes));
-			return static_cast<NBT_TagBase*>(tagPtr);
-		}
-		case Compound: {
-			auto tagPtr = allocateMemory<Compound_Tag>(memRes);
-			new(tagPtr) Compound_Tag(Compound_Tag::fromRawData(name, dataPtr, maxReadLength, out_bytesRead, memRes));
-			return static_cast<NBT_TagBase*>(tagPtr);
-		}
-		case Int_Array: {
-			auto tagPtr = allocateMemory<IntArray_Tag>(memRes);
-			new(tagPtr) IntArray_Tag(IntArray_Tag::fromRawData(name, dataPtr, maxReadLength, out_bytesRead, memRes));
-			return static_cast<NBT_TagBase*>(tagPtr);
-		}
-		case Long_Array: {
-			auto tagPtr = allocateMemory<LongArray_Tag>(memRes);
-			new(tagPtr) LongArray_Tag(LongArray_Tag::fromRawData(name, dataPtr, maxReadLength, out_bytesRead, memRes));
-			return static_cast<NBT_TagBase*>(tagPtr);
-		}
+		case Byte:
+			return constructFromRawData<Byte_Tag>(name, dataPtr, maxReadLength, out_bytesRead, memRes, depth);
+		case Short:
+			return constructFromRawData<Short_Tag>(name, dataPtr, maxReadLength, out_bytesRead, memRes, depth);
+		case Int:
+			return constructFromRawData<Int_Tag>(name, dataPtr, maxReadLength, out_bytesRead, memRes, depth);
+		case Long:
+			return constructFromRawData<Long_Tag>(name, dataPtr, maxReadLength, out_bytesRead, memRes, depth);
+		case Float:
+			return constructFromRawData<Float_Tag>(name, dataPtr, maxReadLength, out_bytesRead, memRes, depth);
+		case Double:
+			return constructFromRawData<Double_Tag>(name, dataPtr, maxReadLength, out_bytesRead, memRes, depth);
+		case Byte_Array:
+			return constructFromRawData<ByteArray_Tag>(name, dataPtr, maxReadLength, out_bytesRead, memRes, depth);
+		case String:
+			return constructFromRawData<String_Tag>(name, dataPtr, maxReadLength, out_bytesRead, memRes, depth);
+		case List:
+			return constructFromRawData<List_Tag>(name, dataPtr, maxReadLength, out_bytesRead, memRes, depth);
+		case Compound:
+			return constructFromRawData<Compound_Tag>(name, dataPtr, maxReadLength, out_bytesRead, memRes, depth);
+		case Int_Array:
+			return constructFromRawData<IntArray_Tag>(name, dataPtr, maxReadLength, out_bytesRead, memRes, depth);
+		case Long_Array:
+			return constructFromRawData<LongArray_Tag>(name, dataPtr, maxReadLength, out_bytesRead, memRes, depth);
 		default:
 			throw std::runtime_error("Attempted to construct an NBT tag from an unknown tag id.");
 		}
@@ -192,7 +190,9 @@ namespace NBT_Lib {
 		}
 	}
 
-	List_Tag List_Tag::fromRawData(const decltype(name)& name, byte* dataPtr, size_t maxReadLength, size_t& out_bytesRead, std::pmr::memory_resource* memRes) {
+	List_Tag List_Tag::fromRawData(std::string_view name, byte* dataPtr, size_t maxReadLength, size_t& out_bytesRead, std::pmr::memory_resource* memRes, size_t depth) {
+		if (depth > NBT_MAX_DEPTH)
+			throw std::runtime_error("Exceeded the maximum nesting depth in TAG_List: " + std::string{ name });
 		if (maxReadLength < sizeof(int8_t))
 			throw std::out_of_range("Data ran out while reading listType of TAG_List: " + std::string{ name });
 
@@ -207,18 +207,28 @@ namespace NBT_Lib {
 		maxReadLength -= sizeof(count);
 		dataPtr += sizeof(count);
 
+		if (count < 0)
+			throw std::runtime_error("Negative length of TAG_List: " + std::string{ name });
+		if (listType > TagID::Long_Array || (listType == TagID::End && count != 0))
+			throw std::runtime_error("Invalid element type of TAG_List: " + std::string{ name });
+		//Reject counts that can not possibly fit in the remaining data before allocating anything for them.
+		if (maxReadLength / std::max<size_t>(minimumPayloadSize(listType), 1u) < size_t(count))
+			throw std::out_of_range("Data ran out while reading elements of TAG_List: " + std::string{ name });
+
 		out_bytesRead = sizeof(int8_t) + sizeof(int32_t);
 
-		decltype(values) tempVals{ (size_t)count, nullptr, memRes };
-		for (auto& ptr : tempVals) {
+		//The elements are added directly to the list, so if parsing fails the list's destructor frees those already constructed.
+		List_Tag list(name, listType, memRes);
+		list.values.reserve(size_t(count));
+		for (int32_t i = 0; i < count; ++i) {
 			size_t bytesRead{ 0u };
-			ptr = constructNewTag(listType, std::pmr::string(memRes), dataPtr, maxReadLength, bytesRead, memRes);
+			list.values.push_back(constructNewTag(listType, {}, dataPtr, maxReadLength, bytesRead, memRes, depth + 1u));
 			out_bytesRead += bytesRead;
 			dataPtr += bytesRead;
 			maxReadLength -= bytesRead;
 		}
 
-		return List_Tag(name, listType, tempVals, memRes);
+		return list;
 	}
 
 	void List_Tag::addTagToBinaryStream(BinaryStream& bstream) const {
@@ -272,51 +282,93 @@ namespace NBT_Lib {
 		}
 	}
 
-	Compound_Tag Compound_Tag::fromRawData(const decltype(name)& name, byte* dataPtr, size_t maxReadLength, size_t& out_bytesRead, std::pmr::memory_resource* memRes) {
+	Compound_Tag Compound_Tag::fromRawData(std::string_view name, byte* dataPtr, size_t maxReadLength, size_t& out_bytesRead, std::pmr::memory_resource* memRes, size_t depth) {
+		if (depth > NBT_MAX_DEPTH)
+			throw std::runtime_error("Exceeded the maximum nesting depth in TAG_Compound: " + std::string{ name });
 		out_bytesRead = 0u;
 
-		decltype(values) tempValues{ memRes };
-
-		while (maxReadLength > 0u) {
-			if (maxReadLength < sizeof(int8_t))
-				throw std::out_of_range("Data ran out while reading tag type of element in TAG_Compound: " + std::string{ name });
-
-			TagID elemType{ static_cast<TagID>(dataPtr[0]) };
-			if (elemType > TagID::Long_Array)
-				throw std::runtime_error("Invalid tag id encountered in TAG_Compound: " + std::string(name));
-
-			++dataPtr;
-			--maxReadLength;
-
-			if (elemType == TagID::End) { //End tag signifies the end of the compound tag.
-				//size_t elemBytesRead{ 0u };
-				//NBT_TagBase* elemPtr = constructNewTag(elemType, std::pmr::string(memRes), dataPtr, maxReadLength, elemBytesRead, memRes);
-				//tempValues.push_back(elemPtr);
-				break;
+		//The element count of a compound is not known up front, so elements are collected on a scratch stack shared by all
+		//nesting levels on this thread. values and indexMap are then allocated once with their final size.
+		//The stack lives outside of memRes, so the outermost call releases it again if a document made it grow large.
+		thread_local std::vector<NBT_TagBase*> scratch;
+		constexpr size_t retainedScratchCapacity{ 1024u };
+		const size_t scratchBegin{ scratch.size() }; //Only the outermost call starts on an empty stack, nested compounds follow their placeholder.
+		auto releaseScratch = [&]() {
+			scratch.resize(scratchBegin);
+			if (scratchBegin == 0u && scratch.capacity() > retainedScratchCapacity)
+				std::vector<NBT_TagBase*>{}.swap(scratch);
+		};
+		try {
+			while (maxReadLength > 0u) {
+				if (maxReadLength < sizeof(int8_t))
+					throw std::out_of_range("Data ran out while reading tag type of element in TAG_Compound: " + std::string{ name });
+
+				TagID elemType{ static_cast<TagID>(dataPtr[0]) };
+				if (elemType > TagID::Long_Array)
+					throw std::runtime_error("Invalid tag id encountered in TAG_Compound: " + std::string(name));
+
+				++dataPtr;
+				--maxReadLength;
+
+				if (elemType == TagID::End) { //End tag signifies the end of the compound tag.
+					//size_t elemBytesRead{ 0u };
+					//NBT_TagBase* elemPtr = constructNewTag(elemType, std::pmr::string(memRes), dataPtr, maxReadLength, elemBytesRead, memRes);
+					//tempValues.push_back(elemPtr);
+					out_bytesRead += sizeof(int8_t);
+					break;
+				}
+
+				if (maxReadLength < sizeof(int16_t))
+					throw std::out_of_range("Data ran out while reading name of element in TAG_Compound: " + std::string{ name });
+
+				size_t nameLength{ copyAndFlipBytes<uint16_t>(dataPtr) };
+				dataPtr += sizeof(int16_t);
+				maxReadLength -= sizeof(int16_t);
+
+				if (maxReadLength < nameLength)
+					throw std::out_of_range("Data ran out while reading name of element in TAG_Compound: " + std::string{ name });
+
+				//The name is passed on as a view of the data and copied once into the new tag, only names that differ in UTF-8 are converted first.
+				std::string_view elemName{ reinterpret_cast<char*>(dataPtr), nameLength };
+				std::pmr::string convertedName{ memRes };
+				bool needsConversion;
+				const size_t utf8Length{ scanMUTF8(elemName.data(), nameLength, needsConversion) };
+				if (utf8Length == SIZE_MAX)
+					throw std::runtime_error("Invalid Modified UTF-8 in name of element in TAG_Compound: " + std::string{ name });
+				if (needsConversion) {
+					convertedName.resize(utf8Length);
+					convertMUTF8ToUTF8(elemName.data(), nameLength, convertedName.data());
+					elemName = convertedName;
+				}
+				dataPtr += nameLength;
+				maxReadLength -= nameLength;
+
+				size_t elemBytesRead{ 0u };
+				scratch.push_back(nullptr); //Grow the scratch stack first, so the new element can not be leaked.
+				scratch.back() = constructNewTag(elemType, elemName, dataPtr, maxReadLength, elemBytesRead, memRes, depth + 1u);
+
+				out_bytesRead += sizeof(int8_t) + sizeof(int16_t) + nameLength + elemBytesRead;
+				dataPtr += elemBytesRead;
+				maxReadLength -= elemBytesRead;
 			}
 
-			if (maxReadLength < sizeof(int16_t))
-				throw std::out_of_range("Data ran out while reading name of element in TAG_Compound: " + std::string{ name });
-
-			size_t nameLength{ static_cast<size_t>(copyAndFlipBytes<int16_t>(dataPtr)) };
-			dataPtr += sizeof(int16_t);
-			maxReadLength -= sizeof(int16_t);
-
-			decltype(name) elemName{ reinterpret_cast<char*>(dataPtr), nameLength, memRes };
-			dataPtr += nameLength;
-			maxReadLength -= nameLength;
-
-			size_t elemBytesRead{ 0u };
-			NBT_TagBase* elemPtr = constructNewTag(elemType, elemName, dataPtr, maxReadLength, elemBytesRead, memRes);
+			Compound_Tag compound(name, memRes);
+			compound.values.assign(scratch.begin() + scratchBegin, scratch.end());
+			releaseScratch(); //The elements are owned by compound from here on.
+			compound.indexMap.reserve(compound.values.size());
+			for (size_t i = 0u; i < compound.values.size(); ++i)
+				compound.indexMap[compound.values[i]->name] = i;
 
-			tempValues.push_back(elemPtr);
-
-			out_bytesRead += sizeof(int8_t) + sizeof(int16_t) + nameLength + elemBytesRead;
-			dataPtr += elemBytesRead;
-			maxReadLength -= elemBytesRead;
+			return compound;
+		}
+		catch (...) {
+			for (size_t i = scratchBegin; i < scratch.size(); ++i) {
+				if (scratch[i])
+					deallocTag(scratch[i]->id, scratch[i], memRes);
+			}
+			releaseScratch();
+			throw;
 		}
-
-		return Compound_Tag(name, tempValues, memRes);
 	}
 
 	void Compound_Tag::addTagToBinaryStream(BinaryStream& bstream) const {
@@ -439,4 +491,287 @@ namespace NBT_Lib {
 		addTabsToStringStream(ss, tabDepth);
 		ss << '}';
 	}
-}
\ No newline at end of file
+
+	namespace {
+		constexpr uint8_t byteAt(const char* data, size_t index) {
+			return static_cast<uint8_t>(data[index]);
+		}
+		constexpr bool isContinuation(uint8_t c) {
+			return (c & 0xc0u) == 0x80u;
+		}
+
+		//Length of the leading run of ASCII bytes. Both encodings are identical for these, so they are skipped 16 bytes at a time.
+		size_t asciiPrefixLength(const char* data, size_t size) {
+			size_t i{ 0u };
+#ifdef NBT_LIB_SSE2
+			for (; i + 16u <= size; i += 16u) {
+				const __m128i block{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)) };
+				const int mask{ _mm_movemask_epi8(block) }; //Top bit of every byte.
+				if (mask != 0)
+					return i + std::countr_zero(static_cast<unsigned>(mask));
+			}
+#else
+			for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+				uint64_t word;
+				memcpy(&word, data + i, sizeof(word));
+				if (word & 0x8080808080808080ull)
+					break;
+			}
+#endif
+			while (i < size && byteAt(data, i) < 0x80u)
+				++i;
+			return i;
+		}
+
+		//Position of the first byte that UTF-8 and MUTF-8 encode differently: NUL or the lead byte of a 4 byte sequence.
+		size_t findMUTF8Special(const char* data, size_t size) {
+			size_t i{ 0u };
+#ifdef NBT_LIB_SSE2
+			const __m128i zero{ _mm_setzero_si128() };
+			const __m128i fourByteLead{ _mm_set1_epi8(static_cast<char>(0xf0u)) };
+			for (; i + 16u <= size; i += 16u) {
+				const __m128i block{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)) };
+				const __m128i isZero{ _mm_cmpeq_epi8(block, zero) };
+				const __m128i isFourByteLead{ _mm_cmpeq_epi8(_mm_max_epu8(block, fourByteLead), block) }; //Unsigned block >= 0xf0
+				const int mask{ _mm_movemask_epi8(_mm_or_si128(isZero, isFourByteLead)) };
+				if (mask != 0)
+					return i + std::countr_zero(static_cast<unsigned>(mask));
+			}
+#endif
+			while (i < size && byteAt(data, i) != 0u && byteAt(data, i) < 0xf0u)
+				++i;
+			return i;
+		}
+
+		//Surrogate encoded in 3 bytes at data, or 0 if there is none.
+		uint32_t surrogateAt(const char* data, size_t remaining) {
+			if (remaining < 3u || byteAt(data, 0) != 0xedu || byteAt(data, 1) < 0xa0u || byteAt(data, 1) > 0xbfu || !isContinuation(byteAt(data, 2)))
+				return 0u;
+			return 0xd000u | (uint32_t(byteAt(data, 1) & 0x3fu) << 6u) | (byteAt(data, 2) & 0x3fu);
+		}
+		constexpr bool isHighSurrogate(uint32_t c) {
+			return c >= 0xd800u && c <= 0xdbffu;
+		}
+		constexpr bool isLowSurrogate(uint32_t c) {
+			return c >= 0xdc00u && c <= 0xdfffu;
+		}
+
+		//Length of a 2 or 3 byte sequence that is encoded identically in MUTF-8 and UTF-8, which is all
+		//non-ASCII text outside of NUL and surrogates, or 0 if the sequence needs the full check.
+		inline size_t plainSequenceLength(const char* data, size_t remaining) {
+			const uint8_t lead{ byteAt(data, 0) };
+			if (lead >= 0xc2u && lead <= 0xdfu) {
+				if (remaining >= 2u && isContinuation(byteAt(data, 1)))
+					return 2u;
+			}
+			else if (lead >= 0xe1u && lead <= 0xefu && lead != 0xedu) {
+				if (remaining >= 3u && isContinuation(byteAt(data, 1)) && isContinuation(byteAt(data, 2)))
+					return 3u;
+			}
+			return 0u;
+		}
+
+		//Length of the valid MUTF-8 sequence at data (a surrogate pair counts as one 6 byte sequence) or 0 if it is invalid.
+		//out_utf8Length receives the length of its UTF-8 form.
+		size_t mutf8SequenceLength(const char* data, size_t remaining, size_t& out_utf8Length) {
+			const uint8_t lead{ byteAt(data, 0) };
+			if (lead < 0x80u) {
+				out_utf8Length = 1u;
+				return 1u;
+			}
+			if (lead >= 0xc0u && lead <= 0xdfu) {
+				if (remaining < 2u || !isContinuation(byteAt(data, 1)))
+					return 0u;
+				if (lead == 0xc0u) { //Only the encoded NUL may be overlong.
+					if (byteAt(data, 1) != 0x80u)
+						return 0u;
+					out_utf8Length = 1u;
+					return 2u;
+				}
+				if (lead == 0xc1u)
+					return 0u;
+				out_utf8Length = 2u;
+				return 2u;
+			}
+			if (lead >= 0xe0u && lead <= 0xefu) {
+				if (remaining < 3u || !isContinuation(byteAt(data, 1)) || !isContinuation(byteAt(data, 2)))
+					return 0u;
+				if (lead == 0xe0u && byteAt(data, 1) < 0xa0u)
+					return 0u;
+				out_utf8Length = 3u;
+				const uint32_t high{ surrogateAt(data, remaining) };
+				if (isHighSurrogate(high) && isLowSurrogate(surrogateAt(data + 3u, remaining - 3u))) {
+					out_utf8Length = 4u;
+					return 6u;
+				}
+				return 3u;
+			}
+			return 0u;
+		}
+	}
+
+	size_t scanMUTF8(const char* data, size_t size, bool& out_needsConversion) {
+		out_needsConversion = false;
+		size_t utf8Length{ 0u };
+		size_t i{ 0u };
+		while (true) {
+			const size_t ascii{ asciiPrefixLength(data + i, size - i) };
+			i += ascii;
+			utf8Length += ascii;
+			if (i == size)
+				return utf8Length;
+
+			//Non-ASCII text mostly consists of plain sequences, which are checked inline until the next ASCII byte.
+			size_t plain{ 0u };
+			while (i < size && (plain = plainSequenceLength(data + i, size - i)) != 0u) {
+				i += plain;
+				utf8Length += plain;
+			}
+			if (i == size)
+				return utf8Length;
+			if (byteAt(data, i) < 0x80u)
+				continue;
+
+			size_t sequenceUTF8Length{ 0u };
+			const size_t sequenceLength{ mutf8SequenceLength(data + i, size - i, sequenceUTF8Length) };
+			if (sequenceLength == 0u)
+				return SIZE_MAX;
+			if (sequenceLength != sequenceUTF8Length)
+				out_needsConversion = true;
+			i += sequenceLength;
+			utf8Length += sequenceUTF8Length;
+		}
+	}
+
+	void convertMUTF8ToUTF8(const char* data, size_t size, char* out) {
+		size_t i{ 0u };
+		while (i < size) {
+			const size_t ascii{ asciiPrefixLength(data + i, size - i) };
+			memcpy(out, data + i, ascii);
+			out += ascii;
+			i += ascii;
+			if (i == size)
+				break;
+
+			size_t utf8Length{ 0u };
+			const size_t sequenceLength{ mutf8SequenceLength(data + i, size - i, utf8Length) };
+			if (sequenceLength == 2u && utf8Length == 1u) {
+				*out++ = '\0';
+			}
+			else if (sequenceLength == 6u) {
+				const uint32_t high{ surrogateAt(data + i, size - i) };
+				const uint32_t low{ surrogateAt(data + i + 3u, size - i - 3u) };
+				const uint32_t codePoint{ 0x10000u + ((high - 0xd800u) << 10u) + (low - 0xdc00u) };
+				*out++ = static_cast<char>(0xf0u | (codePoint >> 18u));
+				*out++ = static_cast<char>(0x80u | ((codePoint >> 12u) & 0x3fu));
+				*out++ = static_cast<char>(0x80u | ((codePoint >> 6u) & 0x3fu));
+				*out++ = static_cast<char>(0x80u | (codePoint & 0x3fu));
+			}
+			else {
+				memcpy(out, data + i, sequenceLength);
+				out += sequenceLength;
+			}
+			i += sequenceLength;
+		}
+	}
+
+	size_t scanUTF8(const char* data, size_t size, bool& out_needsConversion) {
+		//Only set once the whole string is known to be valid, callers catching the exception must not convert it.
+		out_needsConversion = false;
+		size_t mutf8Length{ size };
+		size_t i{ 0u };
+		while (true) {
+			//NUL is the only ASCII character encoded differently, as C0 80.
+			const size_t ascii{ asciiPrefixLength(data + i, size - i) };
+			mutf8Length += size_t(std::count(data + i, data + i + ascii, '\0'));
+			i += ascii;
+
+			size_t plain{ 0u };
+			while (i < size && (plain = plainSequenceLength(data + i, size - i)) != 0u)
+				i += plain;
+			if (i == size) {
+				out_needsConversion = mutf8Length != size;
+				return mutf8Length;
+			}
+
+			//The remaining sequences are checked by the same rules the decoder applies, so everything encoded can be parsed again.
+			const uint8_t lead{ byteAt(data, i) };
+			if (lead < 0x80u)
+				continue;
+			if (lead == 0xe0u || lead == 0xedu) {
+				//Surrogates are allowed, unpaired ones are kept in their 3 byte form when parsing.
+				if (size - i < 3u || !isContinuation(byteAt(data, i + 1u)) || !isContinuation(byteAt(data, i + 2u)) || (lead == 0xe0u && byteAt(data, i + 1u) < 0xa0u))
+					throw std::runtime_error("Invalid UTF-8 sequence in string.");
+				i += 3u;
+				continue;
+			}
+			if (lead < 0xf0u || lead > 0xf4u || size - i < 4u || !isContinuation(byteAt(data, i + 1u)) || !isContinuation(byteAt(data, i + 2u)) || !isContinuation(byteAt(data, i + 3u))
+				|| (lead == 0xf0u && byteAt(data, i + 1u) < 0x90u) || (lead == 0xf4u && byteAt(data, i + 1u) > 0x8fu))
+				throw std::runtime_error("Invalid UTF-8 sequence in string.");
+			mutf8Length += 2u; //4 bytes become 2 surrogates of 3 bytes each.
+			i += 4u;
+		}
+	}
+
+	void convertUTF8ToMUTF8(const char* data, size_t size, char* out) {
+		const auto putSurrogate{ [&](uint32_t surrogate) {
+			*out++ = static_cast<char>(0xe0u | (surrogate >> 12u));
+			*out++ = static_cast<char>(0x80u | ((surrogate >> 6u) & 0x3fu));
+			*out++ = static_cast<char>(0x80u | (surrogate & 0x3fu));
+		} };
+
+		size_t i{ 0u };
+		while (i < size) {
+			const size_t plain{ findMUTF8Special(data + i, size - i) };
+			memcpy(out, data + i, plain);
+			out += plain;
+			i += plain;
+			if (i == size)
+				break;
+
+			if (byteAt(data, i) == 0u) {
+				*out++ = static_cast<char>(0xc0u);
+				*out++ = static_cast<char>(0x80u);
+				++i;
+				continue;
+			}
+			const uint32_t codePoint{ (uint32_t(byteAt(data, i) & 0x07u) << 18u) | (uint32_t(byteAt(data, i + 1u) & 0x3fu) << 12u)
+				| (uint32_t(byteAt(data, i + 2u) & 0x3fu) << 6u) | (byteAt(data, i + 3u) & 0x3fu) };
+			putSurrogate(0xd800u + ((codePoint - 0x10000u) >> 10u));
+			putSurrogate(0xdc00u + ((codePoint - 0x10000u) & 0x3ffu));
+			i += 4u;
+		}
+	}
+
+	std::pmr::string decodeMUTF8(const char* data, size_t size, std::pmr::memory_resource* memRes) {
+		bool needsConversion;
+		const size_t utf8Length{ scanMUTF8(data, size, needsConversion) };
+		if (utf8Length == SIZE_MAX)
+			throw std::runtime_error("Invalid Modified UTF-8 in string.");
+		if (!needsConversion)
+			return std::pmr::string(data, size, memRes);
+
+		std::pmr::string str(utf8Length, '\0', memRes);
+		convertMUTF8ToUTF8(data, size, str.data());
+		return str;
+	}
+
+	void addMUTF8ToBinaryStream(BinaryStream& bstream, std::string_view str) {
+		bool needsConversion;
+		const size_t length{ scanUTF8(str.data(), str.size(), needsConversion) };
+		if (length > UINT16_MAX)
+			throw std::runtime_error("String is too long to be encoded, its Modified UTF-8 form has " + std::to_string(length) + " bytes, at most 65535 are allowed.");
+
+		const uint16_t flippedLength{ byteswap(static_cast<uint16_t>(length)) };
+		bstream.pushbackData(&flippedLength, sizeof(flippedLength));
+		if (!needsConversion) {
+			bstream.pushbackData(str.data(), str.size());
+			return;
+		}
+
+		thread_local std::string converted;
+		converted.resize(length);
+		convertUTF8ToMUTF8(str.data(), str.size(), converted.data());
+		bstream.pushbackData(converted.data(), converted.size());
+	}
+}
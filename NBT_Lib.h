@@ -2,7 +2,10 @@
 #include <unordered_map>
 #include <memory_resource>
 #include <string>
+#include <string_view>
 #include <bit>
+#include <type_traits>
+#include <span>
 #include <sstream>
 
 #include "NBT_LibUtil.h"
@@ -61,6 +64,77 @@ namespace NBT_Lib {
 			return "UNKNOWN_TAG";
 		}
 	}
+	//Smallest number of bytes the payload of a tag can be encoded in, used to reject impossible element counts before allocating.
+	constexpr size_t minimumPayloadSize(TagID id) {
+		using enum TagID;
+		switch (id) {
+		case Byte:
+			return sizeof(int8_t);
+		case Short:
+		case String:
+			return sizeof(int16_t);
+		case Int:
+		case Float:
+		case Byte_Array:
+		case Int_Array:
+		case Long_Array:
+			return sizeof(int32_t);
+		case Long:
+		case Double:
+			return sizeof(int64_t);
+		case List:
+			return sizeof(int8_t) + sizeof(int32_t);
+		case Compound:
+			return sizeof(int8_t);
+		default:
+			return 0u;
+		}
+	}
+
+	//TagID of the number tag holding values of type T.
+	template<typename T>
+	[[nodiscard]]
+	constexpr TagID numberTagID() {
+		if constexpr (std::is_same_v<T, int8_t>)
+			return TagID::Byte;
+		else if constexpr (std::is_same_v<T, int16_t>)
+			return TagID::Short;
+		else if constexpr (std::is_same_v<T, int32_t>)
+			return TagID::Int;
+		else if constexpr (std::is_same_v<T, int64_t>)
+			return TagID::Long;
+		else if constexpr (std::is_same_v<T, float>)
+			return TagID::Float;
+		else if constexpr (std::is_same_v<T, double>)
+			return TagID::Double;
+		else
+			static_assert(!sizeof(T), "Not an NBT number type.");
+	}
+
+	//NBT strings are encoded in Java's Modified UTF-8 (MUTF-8): NUL is encoded as C0 80 and characters outside of the
+	//Basic Multilingual Plane as a pair of 3 byte surrogates. Tags hold standard UTF-8, names and values are converted
+	//when parsing and encoding. Strings without such characters are identical in both encodings and are not converted.
+	//Unpaired surrogates, which Java strings may contain, are kept in their 3 byte form, so every document round trips.
+
+	//Validates MUTF-8 data and returns the length of its UTF-8 form, or SIZE_MAX if it is not valid MUTF-8.
+	//out_needsConversion is set to false if the UTF-8 form is identical to the data.
+	[[nodiscard]]
+	size_t scanMUTF8(const char* data, size_t size, bool& out_needsConversion);
+	//Converts valid MUTF-8 data, out must have room for the length returned by scanMUTF8.
+	void convertMUTF8ToUTF8(const char* data, size_t size, char* out);
+
+	//Returns the length of the MUTF-8 form of UTF-8 data, throws std::runtime_error if it is not valid UTF-8.
+	//out_needsConversion is set to false if the MUTF-8 form is identical to the data.
+	[[nodiscard]]
+	size_t scanUTF8(const char* data, size_t size, bool& out_needsConversion);
+	//Converts UTF-8 data, out must have room for the length returned by scanUTF8.
+	void convertUTF8ToMUTF8(const char* data, size_t size, char* out);
+
+	//Decodes an MUTF-8 string read from NBT data, throws std::runtime_error if it is not valid MUTF-8.
+	[[nodiscard]]
+	std::pmr::string decodeMUTF8(const char* data, size_t size, std::pmr::memory_resource* memRes);
+	//Writes the length prefixed MUTF-8 encoding of a string, throws std::runtime_error if it is longer than 65535 bytes.
+	void addMUTF8ToBinaryStream(BinaryStream& bstream, std::string_view str);
 
 	void inline addTabsToStringStream(std::stringstream& ss, uint8_t tabDepth) {
 		while (tabDepth > 0u) {
@@ -74,23 +148,21 @@ namespace NBT_Lib {
 		TagID id;
 		std::pmr::string name;
 
-		constexpr NBT_TagBase(TagID id, const std::pmr::string& name, std::pmr::memory_resource* memRes) : id{ id }, name{ name, memRes}{
+		NBT_TagBase(TagID id, std::string_view name, std::pmr::memory_resource* memRes) : id{ id }, name{ name, memRes}{
+
+		}
+		//Takes over the name together with its allocator, used by the move constructors.
+		NBT_TagBase(TagID id, std::pmr::string&& name) noexcept : id{ id }, name{ std::move(name) }{
 
 		}
 
 		void addTagHeaderToBinaryStream(BinaryStream& bstream) const {
-			byte header[1u + sizeof(int16_t)];
-			header[0] = static_cast<byte>(static_cast<int8_t>(id));
-			if (id == TagID::End) {
-				bstream.pushbackData(header, 1u);
+			const byte header{ static_cast<byte>(static_cast<int8_t>(id)) };
+			bstream.pushbackData(&header, 1u);
+			if (id == TagID::End)
 				return;
-			}
 
-			int16_t flippedNameLength{ byteswap(static_cast<int16_t>(name.size())) };
-			memcpy(header+1u, &flippedNameLength, sizeof(int16_t));
-			bstream.pushbackData(header, sizeof(header));
-
-			bstream.pushbackData(name.data(), name.size());
+			addMUTF8ToBinaryStream(bstream, name);
 		}
 
 		void virtual addTagToBinaryStream(BinaryStream& bstream) const = 0;
@@ -104,12 +176,12 @@ namespace NBT_Lib {
 
 		}
 		//Copy constructor
-		constexpr End_Tag(const End_Tag& copyFrom)
-			: NBT_TagBase(TagID::End, { copyFrom.name, copyFrom.name.get_allocator() }, copyFrom.name.get_allocator().resource()){
+		End_Tag(const End_Tag& copyFrom)
+			: NBT_TagBase(TagID::End, copyFrom.name, copyFrom.name.get_allocator().resource()){
 		}
 		//Move constructor
 		End_Tag(End_Tag&& moveFrom) noexcept
-			: NBT_TagBase(TagID::End, { std::move(moveFrom.name), moveFrom.name.get_allocator() }, moveFrom.name.get_allocator().resource()) {
+			: NBT_TagBase(TagID::End, std::move(moveFrom.name)) {
 		}
 		//Assignment copy
 		//End_Tag& operator=(const End_Tag& copyFrom) = default;
@@ -129,21 +201,21 @@ namespace NBT_Lib {
 	struct NumberType_Tag : public NBT_TagBase {
 		valueType value;
 
-		NumberType_Tag(const decltype(name)& name, valueType value, std::pmr::memory_resource* memRes) noexcept
+		NumberType_Tag(std::string_view name, valueType value, std::pmr::memory_resource* memRes)
 			: NBT_TagBase(tag_id, name, memRes), value{ value } {
 		}
 		//Copy constructor
 		NumberType_Tag(const NumberType_Tag& copyFrom)
-			: NBT_TagBase(tag_id, { copyFrom.name, copyFrom.name.get_allocator() }, copyFrom.name.get_allocator().resource())
+			: NBT_TagBase(tag_id, copyFrom.name, copyFrom.name.get_allocator().resource())
 			, value{ copyFrom.value }{
 		}
 		//Move constructor
 		NumberType_Tag(NumberType_Tag&& moveFrom) noexcept
-			: NBT_TagBase(tag_id, { std::move(moveFrom.name), moveFrom.name.get_allocator() }, moveFrom.name.get_allocator().resource())
+			: NBT_TagBase(tag_id, std::move(moveFrom.name))
 			, value{ moveFrom.value } {
 		}
 
-		static NumberType_Tag fromRawData(const decltype(name)& name, byte* dataPtr, size_t maxReadLength, size_t& out_bytesRead, std::pmr::memory_resource* memRes){
+		static NumberType_Tag fromRawData(std::string_view name, byte* dataPtr, size_t maxReadLength, size_t& out_bytesRead, std::pmr::memory_resource* memRes){
 
 			if (maxReadLength < sizeof(valueType))
 				throw std::out_of_range("Data ran out while creating " + TagIDToString(tag_id) + ": " + std::string{name});
@@ -178,22 +250,30 @@ namespace NBT_Lib {
 
 	template<typename valueType, TagID tag_id>
 	struct ArrayType_Tag : public NBT_TagBase {
+		using value_type = valueType;
 		std::pmr::vector<valueType> values;
-		ArrayType_Tag(const decltype(name)& name, decltype(values) values, std::pmr::memory_resource* memRes)
+		ArrayType_Tag(std::string_view name, std::pmr::memory_resource* memRes)
+			: NBT_TagBase(tag_id, name, memRes), values{ memRes } {
+		}
+		ArrayType_Tag(std::string_view name, const decltype(values)& values, std::pmr::memory_resource* memRes)
 			: NBT_TagBase(tag_id, name, memRes), values{ values, memRes } {
 		}
+		//Takes over the vector's memory if it was allocated from memRes, otherwise the values are copied.
+		ArrayType_Tag(std::string_view name, decltype(values)&& values, std::pmr::memory_resource* memRes)
+			: NBT_TagBase(tag_id, name, memRes), values{ std::move(values), memRes } {
+		}
 		//Copy constructor
 		ArrayType_Tag(const ArrayType_Tag& copyFrom)
-			: NBT_TagBase(tag_id, { copyFrom.name, copyFrom.name.get_allocator() }, copyFrom.name.get_allocator().resource())
+			: NBT_TagBase(tag_id, copyFrom.name, copyFrom.name.get_allocator().resource())
 			, values{ copyFrom.values, copyFrom.values.get_allocator() }{
 		}
 		//Move constructor
 		ArrayType_Tag(ArrayType_Tag&& moveFrom) noexcept
-			: NBT_TagBase(tag_id, { std::move(moveFrom.name), moveFrom.name.get_allocator() }, moveFrom.name.get_allocator().resource())
+			: NBT_TagBase(tag_id, std::move(moveFrom.name))
 			, values{ std::move(moveFrom.values) } {
 		}
 
-		static ArrayType_Tag fromRawData(const decltype(name)& name, byte* dataPtr, size_t maxReadLength, size_t& out_bytesRead, std::pmr::memory_resource* memRes) {
+		static ArrayType_Tag fromRawData(std::string_view name, byte* dataPtr, size_t maxReadLength, size_t& out_bytesRead, std::pmr::memory_resource* memRes) {
 			if (maxReadLength < sizeof(int32_t))
 				throw std::out_of_range("Data ran out while reading length of " + TagIDToString(tag_id) + ": " + std::string{ name });
 
@@ -201,7 +281,9 @@ namespace NBT_Lib {
 			maxReadLength -= sizeof(count);
 			dataPtr += sizeof(count);
 
-			if (maxReadLength < count * sizeof(valueType))
+			if (count < 0)
+				throw std::runtime_error("Negative length of " + TagIDToString(tag_id) + ": " + std::string{ name });
+			if (maxReadLength < size_t(count) * sizeof(valueType))
 				throw std::out_of_range("Data ran out while reading values of " + TagIDToString(tag_id) + ": " + std::string{ name });
 
 			decltype(values) valArray{ (size_t)count, {}, memRes };
@@ -211,16 +293,20 @@ namespace NBT_Lib {
 			}
 
 			out_bytesRead = sizeof(count) + count * sizeof(valueType);
-			return ArrayType_Tag<valueType, tag_id>(name, valArray, memRes);
+			return ArrayType_Tag<valueType, tag_id>(name, std::move(valArray), memRes);
 		}
 
 		void addTagToBinaryStream(BinaryStream& bstream) const override {
 			const int32_t flippedLength{ byteswap(static_cast<int32_t>(values.size())) };
 			bstream.pushbackData(&flippedLength, sizeof(flippedLength));
 			
-			for (valueType val : values) {
-				valueType temp{ byteswap(val) };
-				bstream.pushbackData(&temp, sizeof(valueType));
+			//Values are swapped into a small block first, so the stream is not called for every value.
+			valueType block[64u];
+			for (size_t i = 0u; i < values.size(); i += std::size(block)) {
+				const size_t blockCount{ std::min(values.size() - i, std::size(block)) };
+				for (size_t j = 0u; j < blockCount; ++j)
+					block[j] = byteswap(values[i + j]);
+				bstream.pushbackData(block, blockCount * sizeof(valueType));
 			}
 		}
 
@@ -248,40 +334,44 @@ namespace NBT_Lib {
 	
 	struct String_Tag : public NBT_TagBase {
 		decltype(name) value;
-		String_Tag(const decltype(name)& name, decltype(value) value, std::pmr::memory_resource* memRes) noexcept
+		String_Tag(std::string_view name, std::string_view value, std::pmr::memory_resource* memRes)
 			: NBT_TagBase(TagID::String, name, memRes), value{ value, memRes } {
 		}
+		String_Tag(std::string_view name, const char* value, std::pmr::memory_resource* memRes)
+			: String_Tag(name, std::string_view{ value }, memRes) {
+		}
+		//Takes over the string's memory if it was allocated from memRes, otherwise it is copied.
+		String_Tag(std::string_view name, decltype(value)&& value, std::pmr::memory_resource* memRes)
+			: NBT_TagBase(TagID::String, name, memRes), value{ std::move(value), memRes } {
+		}
 		//Copy constructor
 		String_Tag(const String_Tag& copyFrom)
-			: NBT_TagBase(TagID::String, { copyFrom.name, copyFrom.name.get_allocator() }, copyFrom.name.get_allocator().resource())
+			: NBT_TagBase(TagID::String, copyFrom.name, copyFrom.name.get_allocator().resource())
 			, value{ copyFrom.value, copyFrom.value.get_allocator() }{
 		}
 		//Move constructor
 		String_Tag(String_Tag&& moveFrom) noexcept
-			: NBT_TagBase(TagID::String, { std::move(moveFrom.name), moveFrom.name.get_allocator() }, moveFrom.name.get_allocator().resource())
+			: NBT_TagBase(TagID::String, std::move(moveFrom.name))
 			, value{ std::move(moveFrom.value), moveFrom.value.get_allocator()} {
 		}
 
-		static String_Tag inline fromRawData(const decltype(name)& name, byte* dataPtr, size_t maxReadLength, size_t& out_bytesRead, std::pmr::memory_resource* memRes) {
-			if (maxReadLength < sizeof(int16_t))
+		static String_Tag inline fromRawData(std::string_view name, byte* dataPtr, size_t maxReadLength, size_t& out_bytesRead, std::pmr::memory_resource* memRes) {
+			if (maxReadLength < sizeof(uint16_t))
 				throw std::out_of_range("Data ran out while reading length of TAG_String: " + std::string{ name });
 
-			int16_t count = copyAndFlipBytes<int16_t>(dataPtr);
-			maxReadLength -= sizeof(count);
-			dataPtr += sizeof(count);
+			const size_t count{ copyAndFlipBytes<uint16_t>(dataPtr) };
+			maxReadLength -= sizeof(uint16_t);
+			dataPtr += sizeof(uint16_t);
 
 			if (maxReadLength < count * sizeof(char))
 				throw std::out_of_range("Data ran out while reading characters of TAG_String: " + std::string{ name });
 
-			out_bytesRead = sizeof(int16_t) + count;
-			return String_Tag(name, decltype(value)(reinterpret_cast<char*>(dataPtr), count, memRes), memRes);
+			out_bytesRead = sizeof(uint16_t) + count;
+			return String_Tag(name, decodeMUTF8(reinterpret_cast<char*>(dataPtr), count, memRes), memRes);
 		}
 
 		void addTagToBinaryStream(BinaryStream& bstream) const override {
-			const int16_t flippedStringLength{ byteswap(static_cast<int16_t>(value.size())) };
-			bstream.pushbackData(&flippedStringLength, sizeof(flippedStringLength));
-
-			bstream.pushbackData(value.data(), value.size());
+			addMUTF8ToBinaryStream(bstream, value);
 		}
 
 		void addToStringStream(std::stringstream& ss, uint8_t tabDepth) const {
@@ -290,21 +380,32 @@ namespace NBT_Lib {
 		}
 	};
 
-	NBT_TagBase* constructNewTag(TagID id, const decltype(NBT_TagBase::name)& name, byte* dataPtr, size_t maxReadLength, size_t& out_bytesRead, std::pmr::memory_resource* memRes);
+	//Hard upper bound of the nesting depth of compounds and lists, matching the limit used by Minecraft itself.
+	//Parsing throws std::runtime_error for deeper documents, validateNBT rejects them.
+	constexpr size_t NBT_MAX_DEPTH{ 512u };
+
+	NBT_TagBase* constructNewTag(TagID id, std::string_view name, byte* dataPtr, size_t maxReadLength, size_t& out_bytesRead, std::pmr::memory_resource* memRes, size_t depth);
 	
 	void deallocTag(TagID id, NBT_TagBase* ptr, std::pmr::memory_resource* memRes);
 
 	struct List_Tag : public NBT_TagBase {
 		TagID listType;
 		std::pmr::vector<NBT_TagBase*> values;
-		List_Tag(const decltype(name)& name, TagID listType, decltype(values) values, std::pmr::memory_resource* memRes)
+		List_Tag(std::string_view name, TagID listType, std::pmr::memory_resource* memRes)
+			: NBT_TagBase(TagID::List, name, memRes), listType{ listType }, values{ memRes } {
+		}
+		//The list takes ownership of the tags in values.
+		List_Tag(std::string_view name, TagID listType, const decltype(values)& values, std::pmr::memory_resource* memRes)
 			: NBT_TagBase(TagID::List, name, memRes), listType{ listType }, values{ values, memRes} {
 		}
+		List_Tag(std::string_view name, TagID listType, decltype(values)&& values, std::pmr::memory_resource* memRes)
+			: NBT_TagBase(TagID::List, name, memRes), listType{ listType }, values{ std::move(values), memRes} {
+		}
 		//Copy constructor
 		List_Tag(const List_Tag& copyFrom) = delete;
 		List_Tag(const List_Tag& copyFrom, std::pmr::memory_resource* memRes)
-			: NBT_TagBase(TagID::List, { copyFrom.name, copyFrom.name.get_allocator() }, copyFrom.name.get_allocator().resource())
-			, values{ copyFrom.values, copyFrom.values.get_allocator() }, listType{ copyFrom.listType }{
+			: NBT_TagBase(TagID::List, copyFrom.name, copyFrom.name.get_allocator().resource())
+			, listType{ copyFrom.listType }, values{ copyFrom.values, copyFrom.values.get_allocator() }{
 
 			for (size_t i = 0u; i < values.size(); ++i) {
 				values[i] = copyTag(values[i], memRes);
@@ -312,8 +413,8 @@ namespace NBT_Lib {
 		}
 		//Move constructor
 		List_Tag(List_Tag&& moveFrom) noexcept
-			: NBT_TagBase(TagID::List, { std::move(moveFrom.name), moveFrom.name.get_allocator() }, moveFrom.name.get_allocator().resource())
-			, values{ std::move(moveFrom.values) }, listType{ moveFrom.listType } {
+			: NBT_TagBase(TagID::List, std::move(moveFrom.name))
+			, listType{ moveFrom.listType }, values{ std::move(moveFrom.values) } {
 		}
 
 		~List_Tag() {
@@ -321,7 +422,39 @@ namespace NBT_Lib {
 				deallocTag(listType, v, values.get_allocator().resource());
 		}
 
-		static List_Tag fromRawData(const decltype(name)& name, byte* dataPtr, size_t maxReadLength, size_t& out_bytesRead, std::pmr::memory_resource* memRes);
+		void reserve(size_t count) {
+			values.reserve(count);
+		}
+
+		//Constructs an element in place with memory from the list's memory resource and appends it, args are the element's
+		//constructor arguments after its name. An empty list of TAG_End takes the type of the element, otherwise the element
+		//must have the list's type or std::runtime_error is thrown.
+		template<typename tagType, typename... argTypes> requires std::derived_from<tagType, NBT_TagBase>
+		tagType& emplace(argTypes&&... args) {
+			std::pmr::memory_resource* memRes{ values.get_allocator().resource() };
+			tagType* tagPtr{ allocateMemory<tagType>(memRes) };
+			try {
+				new(tagPtr) tagType(std::string_view{}, std::forward<argTypes>(args)..., memRes);
+			}
+			catch (...) {
+				memRes->deallocate(tagPtr, sizeof(tagType), alignof(tagType));
+				throw;
+			}
+			try {
+				if (tagPtr->id != listType && (listType != TagID::End || !values.empty()))
+					throw std::runtime_error("Added " + TagIDToString(tagPtr->id) + " to TAG_List of " + TagIDToString(listType) + ": " + std::string{ name });
+				values.push_back(tagPtr);
+			}
+			catch (...) {
+				deallocateMemory<tagType>(tagPtr, memRes);
+				throw;
+			}
+			listType = tagPtr->id;
+			return *tagPtr;
+		}
+
+		//depth is the nesting depth of the list itself, the root compound has depth 1.
+		static List_Tag fromRawData(std::string_view name, byte* dataPtr, size_t maxReadLength, size_t& out_bytesRead, std::pmr::memory_resource* memRes, size_t depth = 1u);
 
 		void addTagToBinaryStream(BinaryStream& bstream) const override;
 		void addToStringStream(std::stringstream& ss, uint8_t tabDepth) const;
@@ -339,17 +472,22 @@ namespace NBT_Lib {
 		std::pmr::vector<NBT_TagBase*> values;
 		std::pmr::unordered_map<std::pmr::string, size_t> indexMap; //string key, size_t value is the index in the vector.
 		
-		Compound_Tag(const decltype(name)& name, decltype(values) values, std::pmr::memory_resource* memRes)
+		Compound_Tag(std::string_view name, std::pmr::memory_resource* memRes)
+			: NBT_TagBase(TagID::Compound, name, memRes), values{ memRes }, indexMap{ memRes } {
+		}
+		//The compound takes ownership of the tags in values.
+		Compound_Tag(std::string_view name, const decltype(values)& values, std::pmr::memory_resource* memRes)
 			: NBT_TagBase(TagID::Compound, name, memRes), values{ values, memRes }, indexMap{ memRes } {
-
-			for (size_t i = 0u; i < values.size(); ++i) {
-				indexMap[values[i]->name] = i;
-			}
+			buildIndex();
+		}
+		Compound_Tag(std::string_view name, decltype(values)&& values, std::pmr::memory_resource* memRes)
+			: NBT_TagBase(TagID::Compound, name, memRes), values{ std::move(values), memRes }, indexMap{ memRes } {
+			buildIndex();
 		}
 		//Copy constructor
 		Compound_Tag(const Compound_Tag& copyFrom) = delete;
 		Compound_Tag(const Compound_Tag& copyFrom, std::pmr::memory_resource* memRes)
-			: NBT_TagBase(TagID::Compound, { copyFrom.name, memRes }, memRes)
+			: NBT_TagBase(TagID::Compound, copyFrom.name, memRes)
 			, values{ copyFrom.values, memRes }, indexMap{ copyFrom.indexMap, memRes }{
 
 			for (size_t i = 0u; i < values.size(); ++i) {
@@ -358,7 +496,7 @@ namespace NBT_Lib {
 		}
 		//Move constructor
 		Compound_Tag(Compound_Tag&& moveFrom) noexcept
-			: NBT_TagBase(TagID::Compound, { std::move(moveFrom.name), moveFrom.name.get_allocator()}, moveFrom.name.get_allocator().resource())
+			: NBT_TagBase(TagID::Compound, std::move(moveFrom.name))
 			, values{ std::move(moveFrom.values) }, indexMap{ std::move(moveFrom.indexMap) } {
 		}
 
@@ -368,17 +506,67 @@ namespace NBT_Lib {
 			}
 		}
 
+		//The compound takes ownership of the tag, if adding it throws the tag is still owned by the caller.
 		void inline addTag(NBT_TagBase* tagPtr) {
 			values.push_back(tagPtr);
-			indexMap[tagPtr->name] = values.size() - 1u;
+			try {
+				indexMap[tagPtr->name] = values.size() - 1u;
+			}
+			catch (...) {
+				values.pop_back();
+				throw;
+			}
+		}
+
+		void reserve(size_t count) {
+			values.reserve(count);
+			indexMap.reserve(count);
+		}
+
+		//Constructs a tag in place with memory from the compound's memory resource and adds it, args are the tag's
+		//constructor arguments between its name and the memory resource, e.g. emplace<Int_Tag>("x", 5).
+		//Vectors and strings passed as rvalues are taken over without copying if they were allocated from the same resource.
+		template<typename tagType, typename... argTypes> requires std::derived_from<tagType, NBT_TagBase>
+		tagType& emplace(std::string_view name, argTypes&&... args) {
+			std::pmr::memory_resource* memRes{ values.get_allocator().resource() };
+			tagType* tagPtr{ allocateMemory<tagType>(memRes) };
+			try {
+				new(tagPtr) tagType(name, std::forward<argTypes>(args)..., memRes);
+			}
+			catch (...) {
+				memRes->deallocate(tagPtr, sizeof(tagType), alignof(tagType));
+				throw;
+			}
+			try {
+				addTag(tagPtr);
+			}
+			catch (...) {
+				deallocateMemory<tagType>(tagPtr, memRes);
+				throw;
+			}
+			return *tagPtr;
+		}
+
+		//Adds an array tag holding a copy of arrayValues, its vector is allocated once with the final size.
+		template<typename arrayType> requires std::derived_from<arrayType, NBT_TagBase>
+		arrayType& emplaceArray(std::string_view name, std::span<const typename arrayType::value_type> arrayValues) {
+			return emplace<arrayType>(name, decltype(arrayType::values)(arrayValues.begin(), arrayValues.end(), values.get_allocator()));
 		}
 
-		static Compound_Tag fromRawData(const decltype(name)& name, byte* dataPtr, size_t maxReadLength, size_t& out_bytesRead, std::pmr::memory_resource* memRes);
+		//depth is the nesting depth of the compound itself, the root compound has depth 1.
+		static Compound_Tag fromRawData(std::string_view name, byte* dataPtr, size_t maxReadLength, size_t& out_bytesRead, std::pmr::memory_resource* memRes, size_t depth = 1u);
 
 		void addTagToBinaryStream(BinaryStream& bstream) const override;
 		void addToStringStream(std::stringstream& ss, uint8_t tabDepth) const;
 
 	private:
+		void buildIndex() {
+			indexMap.reserve(values.size());
+			for (size_t i = 0u; i < values.size(); ++i) {
+				indexMap[values[i]->name] = i;
+			}
+		}
+
 		template<typename valueType> requires std::derived_from<valueType, NBT_TagBase>
 		void addFullTagToBinaryStream(NBT_TagBase* tagPtr, BinaryStream& bstream) const {
 			valueType* ptr{ reinterpret_cast<valueType*>(tagPtr) };
@@ -390,5 +578,7 @@ namespace NBT_Lib {
 	Compound_Tag parseNBT(void* dataPtr, size_t dataSize, std::pmr::memory_resource* memRes);
 
 	std::vector<byte> buildBinaryNBTFile(const Compound_Tag* root);
+	//Appends the encoded document to out, reusing its capacity.
+	void buildBinaryNBTFile(const Compound_Tag* root, std::vector<byte>& out);
 
 }
@@ -0,0 +1,363 @@
+#include "NBT_LibAsync.h"
+
+#include "NBT_LibValidate.h"
+
+namespace NBT_Lib {
+	namespace {
+		//Largest part of an array read or written at once, so arrays never have to be buffered whole.
+		constexpr size_t ARRAY_PIECE_SIZE{ 1u << 16u };
+		//Upper bound for reserving elements of arrays and lists before their data has arrived.
+		constexpr size_t MAX_RESERVED_ELEMENTS{ 1u << 12u };
+
+		//Adds a new tag to a compound or list being decoded.
+		template<typename tagType, typename... argTypes>
+		tagType& addToContainer(NBT_TagBase* container, std::string_view name, argTypes&&... args) {
+			if (container->id == TagID::Compound)
+				return static_cast<Compound_Tag*>(container)->emplace<tagType>(name, std::forward<argTypes>(args)...);
+			return static_cast<List_Tag*>(container)->emplace<tagType>(std::forward<argTypes>(args)...);
+		}
+
+		template<typename tagType>
+		void addNumber(NBT_TagBase* container, std::string_view name, byte* dataPtr) {
+			addToContainer<tagType>(container, name, copyAndFlipBytes<decltype(tagType::value)>(dataPtr));
+		}
+
+		template<typename arrayType>
+		void appendArrayValues(NBT_TagBase* arrayTag, const byte* dataPtr, size_t count) {
+			using valueType = typename arrayType::value_type;
+			auto& values{ static_cast<arrayType*>(arrayTag)->values };
+			const size_t offset{ values.size() };
+			values.resize(offset + count);
+			for (size_t i = 0u; i < count; ++i)
+				values[offset + i] = copyAndFlipBytes<valueType>(const_cast<byte*>(dataPtr) + i * sizeof(valueType));
+		}
+
+		//Appends count values of an array tag starting at first to the stream.
+		template<typename arrayType>
+		void addArrayValues(const NBT_TagBase* arrayTag, size_t first, size_t count, BinaryStream& bstream) {
+			using valueType = typename arrayType::value_type;
+			const auto& values{ static_cast<const arrayType*>(arrayTag)->values };
+			valueType block[64u];
+			for (size_t i = 0u; i < count; i += std::size(block)) {
+				const size_t blockCount{ std::min(count - i, std::size(block)) };
+				for (size_t j = 0u; j < blockCount; ++j)
+					block[j] = byteswap(values[first + i + j]);
+				bstream.pushbackData(block, blockCount * sizeof(valueType));
+			}
+		}
+
+		size_t arrayLength(const NBT_TagBase* tag) {
+			switch (tag->id) {
+				using enum TagID;
+			case Byte_Array:
+				return static_cast<const ByteArray_Tag*>(tag)->values.size();
+			case Int_Array:
+				return static_cast<const IntArray_Tag*>(tag)->values.size();
+			case Long_Array:
+				return static_cast<const LongArray_Tag*>(tag)->values.size();
+			default:
+				return 0u;
+			}
+		}
+
+		size_t arrayElementSize(TagID id) {
+			switch (id) {
+				using enum TagID;
+			case Int_Array:
+				return sizeof(int32_t);
+			case Long_Array:
+				return sizeof(int64_t);
+			default:
+				return sizeof(int8_t);
+			}
+		}
+	}
+
+	void NBT_AsyncInput::push(const void* data, size_t size) {
+		//Drop consumed data before adding more, so the buffer does not grow with the size of the document.
+		if (readOffset == buffer.size()) {
+			buffer.clear();
+			readOffset = 0u;
+		}
+		else if (readOffset >= (1u << 16u) && readOffset * 2u >= buffer.size()) {
+			buffer.erase(buffer.begin(), buffer.begin() + readOffset);
+			readOffset = 0u;
+		}
+
+		const byte* dataPtr{ static_cast<const byte*>(data) };
+		buffer.insert(buffer.end(), dataPtr, dataPtr + size);
+		resumeReader();
+	}
+
+	NBT_Task<Compound_Tag> decodeAsync(NBT_AsyncInput& input, std::pmr::memory_resource* memRes) {
+		//Releases waiting producers however decoding ends: on success, when throwing and when the task is destroyed while suspended.
+		struct FinishGuard {
+			NBT_AsyncInput& input;
+			~FinishGuard() {
+				input.finishReading();
+			}
+		} finishGuard{ input };
+
+		co_await input.need(sizeof(int8_t) + sizeof(int16_t));
+		if (input.data()[0] != static_cast<byte>(TagID::Compound))
+			throw std::runtime_error("Root tag must be TAG_Compound, but it was " + TagIDToString(static_cast<TagID>(input.data()[0])));
+		const size_t rootNameLength{ copyAndFlipBytes<uint16_t>(input.data() + sizeof(int8_t)) };
+		co_await input.need(sizeof(int8_t) + sizeof(int16_t) + rootNameLength);
+		input.consume(sizeof(int8_t) + sizeof(int16_t) + rootNameLength);
+
+		struct Frame {
+			NBT_TagBase* container; //Compound or list.
+			TagID elementType;
+			size_t remaining; //Elements of a list still to be read.
+		};
+		Compound_Tag root("", memRes);
+		std::vector<Frame> stack;
+		stack.push_back({ &root, TagID::End, 0u });
+		std::string name; //Name of the current compound entry, converted to UTF-8.
+
+		while (!stack.empty()) {
+			NBT_TagBase* container{ stack.back().container };
+			TagID type;
+			if (container->id == TagID::Compound) {
+				co_await input.need(sizeof(int8_t));
+				type = static_cast<TagID>(input.data()[0]);
+				input.consume(sizeof(int8_t));
+				if (type == TagID::End) {
+					stack.pop_back();
+					continue;
+				}
+				if (type > TagID::Long_Array)
+					throw std::runtime_error("Invalid tag id encountered in TAG_Compound: " + std::string{ container->name });
+
+				co_await input.need(sizeof(int16_t));
+				const size_t nameLength{ copyAndFlipBytes<uint16_t>(input.data()) };
+				co_await input.need(sizeof(int16_t) + nameLength);
+				const char* nameData{ reinterpret_cast<const char*>(input.data() + sizeof(int16_t)) };
+				bool needsConversion;
+				const size_t utf8Length{ scanMUTF8(nameData, nameLength, needsConversion) };
+				if (utf8Length == SIZE_MAX)
+					throw std::runtime_error("Invalid Modified UTF-8 in name of element in TAG_Compound: " + std::string{ container->name });
+				if (needsConversion) {
+					name.resize(utf8Length);
+					convertMUTF8ToUTF8(nameData, nameLength, name.data());
+				}
+				else {
+					name.assign(nameData, nameLength);
+				}
+				input.consume(sizeof(int16_t) + nameLength);
+			}
+			else {
+				Frame& frame{ stack.back() };
+				if (frame.remaining == 0u) {
+					stack.pop_back();
+					continue;
+				}
+				--frame.remaining;
+				type = frame.elementType;
+				name.clear();
+			}
+
+			switch (type) {
+				using enum TagID;
+			case Byte:
+				co_await input.need(sizeof(int8_t));
+				addNumber<Byte_Tag>(container, name, input.data());
+				input.consume(sizeof(int8_t));
+				break;
+			case Short:
+				co_await input.need(sizeof(int16_t));
+				addNumber<Short_Tag>(container, name, input.data());
+				input.consume(sizeof(int16_t));
+				break;
+			case Int:
+				co_await input.need(sizeof(int32_t));
+				addNumber<Int_Tag>(container, name, input.data());
+				input.consume(sizeof(int32_t));
+				break;
+			case Long:
+				co_await input.need(sizeof(int64_t));
+				addNumber<Long_Tag>(container, name, input.data());
+				input.consume(sizeof(int64_t));
+				break;
+			case Float:
+				co_await input.need(sizeof(float));
+				addNumber<Float_Tag>(container, name, input.data());
+				input.consume(sizeof(float));
+				break;
+			case Double:
+				co_await input.need(sizeof(double));
+				addNumber<Double_Tag>(container, name, input.data());
+				input.consume(sizeof(double));
+				break;
+			case String: {
+				co_await input.need(sizeof(uint16_t));
+				const size_t length{ copyAndFlipBytes<uint16_t>(input.data()) };
+				co_await input.need(sizeof(uint16_t) + length);
+				addToContainer<String_Tag>(container, name, decodeMUTF8(reinterpret_cast<const char*>(input.data() + sizeof(uint16_t)), length, memRes));
+				input.consume(sizeof(uint16_t) + length);
+				break;
+			}
+			case Byte_Array:
+			case Int_Array:
+			case Long_Array: {
+				co_await input.need(sizeof(int32_t));
+				const int32_t count{ copyAndFlipBytes<int32_t>(input.data()) };
+				input.consume(sizeof(int32_t));
+				if (count < 0)
+					throw std::runtime_error("Negative length of " + TagIDToString(type) + ": " + name);
+
+				NBT_TagBase* arrayTag;
+				if (type == Byte_Array)
+					arrayTag = &addToContainer<ByteArray_Tag>(container, name);
+				else if (type == Int_Array)
+					arrayTag = &addToContainer<IntArray_Tag>(container, name);
+				else
+					arrayTag = &addToContainer<LongArray_Tag>(container, name);
+
+				//The values are read in pieces as they arrive, only a bounded number is reserved up front since the count is not trusted.
+				const size_t elementSize{ arrayElementSize(type) };
+				const size_t piece{ ARRAY_PIECE_SIZE / elementSize };
+				if (type == Byte_Array)
+					static_cast<ByteArray_Tag*>(arrayTag)->values.reserve(std::min<size_t>(count, MAX_RESERVED_ELEMENTS));
+				else if (type == Int_Array)
+					static_cast<IntArray_Tag*>(arrayTag)->values.reserve(std::min<size_t>(count, MAX_RESERVED_ELEMENTS));
+				else
+					static_cast<LongArray_Tag*>(arrayTag)->values.reserve(std::min<size_t>(count, MAX_RESERVED_ELEMENTS));
+
+				for (size_t read = 0u; read < size_t(count);) {
+					const size_t pieceCount{ std::min(size_t(count) - read, piece) };
+					co_await input.need(pieceCount * elementSize);
+					if (type == Byte_Array)
+						appendArrayValues<ByteArray_Tag>(arrayTag, input.data(), pieceCount);
+					else if (type == Int_Array)
+						appendArrayValues<IntArray_Tag>(arrayTag, input.data(), pieceCount);
+					else
+						appendArrayValues<LongArray_Tag>(arrayTag, input.data(), pieceCount);
+					input.consume(pieceCount * elementSize);
+					read += pieceCount;
+				}
+				break;
+			}
+			case List: {
+				co_await input.need(sizeof(int8_t) + sizeof(int32_t));
+				const TagID listType{ static_cast<TagID>(input.data()[0]) };
+				const int32_t count{ copyAndFlipBytes<int32_t>(input.data() + sizeof(int8_t)) };
+				input.consume(sizeof(int8_t) + sizeof(int32_t));
+				if (count < 0)
+					throw std::runtime_error("Negative length of TAG_List: " + name);
+				if (listType > Long_Array || (listType == End && count != 0))
+					throw std::runtime_error("Invalid element type of TAG_List: " + name);
+				if (stack.size() >= NBT_MAX_DEPTH)
+					throw std::runtime_error("NBT document is nested deeper than " + std::to_string(NBT_MAX_DEPTH) + " levels.");
+
+				List_Tag& list{ addToContainer<List_Tag>(container, name, listType) };
+				list.reserve(std::min<size_t>(count, MAX_RESERVED_ELEMENTS));
+				stack.push_back({ &list, listType, size_t(count) });
+				break;
+			}
+			case Compound: {
+				if (stack.size() >= NBT_MAX_DEPTH)
+					throw std::runtime_error("NBT document is nested deeper than " + std::to_string(NBT_MAX_DEPTH) + " levels.");
+				Compound_Tag& compound{ addToContainer<Compound_Tag>(container, name) };
+				stack.push_back({ &compound, End, 0u });
+				break;
+			}
+			default:
+				break;
+			}
+		}
+
+		co_return std::move(root);
+	}
+
+	NBT_ChunkGenerator encodeAsync(const Compound_Tag* root, size_t chunkSize) {
+		chunkSize = std::max<size_t>(chunkSize, 1u);
+
+		//Lists and compounds are walked with an explicit stack, arrays are written in pieces, so at most a chunk
+		//and the encoding of a single number or string are buffered at any time.
+		struct Frame {
+			const NBT_TagBase* tag; //Compound, list or array.
+			size_t next; //Index of the next element, or of the next array value.
+		};
+		std::vector<byte> buffer;
+		BinaryStream bstream(buffer);
+		size_t sent{ 0u };
+		std::vector<Frame> stack;
+
+		root->addTagHeaderToBinaryStream(bstream);
+		stack.push_back({ root, 0u });
+		while (!stack.empty()) {
+			Frame& frame{ stack.back() };
+			const NBT_TagBase* tag{ frame.tag };
+			if (tag->id == TagID::Compound || tag->id == TagID::List) {
+				const bool isCompound{ tag->id == TagID::Compound };
+				const auto& values{ isCompound ? static_cast<const Compound_Tag*>(tag)->values : static_cast<const List_Tag*>(tag)->values };
+				if (frame.next == values.size()) {
+					if (isCompound) {
+						const byte end{ static_cast<byte>(TagID::End) };
+						bstream.pushbackData(&end, 1u);
+					}
+					stack.pop_back();
+				}
+				else {
+					const NBT_TagBase* element{ values[frame.next++] };
+					if (isCompound)
+						element->addTagHeaderToBinaryStream(bstream);
+
+					switch (element->id) {
+						using enum TagID;
+					case Compound:
+						stack.push_back({ element, 0u });
+						break;
+					case List: {
+						const List_Tag* list{ static_cast<const List_Tag*>(element) };
+						byte listHeader[1u + sizeof(int32_t)];
+						listHeader[0] = static_cast<byte>(static_cast<int8_t>(list->listType));
+						const int32_t flippedLength{ byteswap(static_cast<int32_t>(list->values.size())) };
+						memcpy(listHeader + 1u, &flippedLength, sizeof(flippedLength));
+						bstream.pushbackData(listHeader, sizeof(listHeader));
+						stack.push_back({ element, 0u });
+						break;
+					}
+					case Byte_Array:
+					case Int_Array:
+					case Long_Array: {
+						const int32_t flippedLength{ byteswap(static_cast<int32_t>(arrayLength(element))) };
+						bstream.pushbackData(&flippedLength, sizeof(flippedLength));
+						stack.push_back({ element, 0u });
+						break;
+					}
+					default:
+						element->addTagToBinaryStream(bstream);
+						break;
+					}
+				}
+			}
+			else {
+				const size_t length{ arrayLength(tag) };
+				const size_t count{ std::min(length - frame.next, ARRAY_PIECE_SIZE / arrayElementSize(tag->id)) };
+				if (tag->id == TagID::Byte_Array)
+					addArrayValues<ByteArray_Tag>(tag, frame.next, count, bstream);
+				else if (tag->id == TagID::Int_Array)
+					addArrayValues<IntArray_Tag>(tag, frame.next, count, bstream);
+				else
+					addArrayValues<LongArray_Tag>(tag, frame.next, count, bstream);
+				frame.next += count;
+				if (frame.next == length)
+					stack.pop_back();
+			}
+
+			while (buffer.size() - sent >= chunkSize) {
+				co_yield std::span<const byte>{ buffer.data() + sent, chunkSize };
+				sent += chunkSize;
+			}
+			if (sent != 0u) {
+				buffer.erase(buffer.begin(), buffer.begin() + sent);
+				sent = 0u;
+			}
+		}
+
+		if (!buffer.empty())
+			co_yield std::span<const byte>{ buffer.data(), buffer.size() };
+	}
+}
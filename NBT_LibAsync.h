@@ -0,0 +1,369 @@
+#pragma once
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <functional>
+#include <deque>
+#include <span>
+#include <vector>
+#include <type_traits>
+#include <utility>
+
+#include "NBT_Lib.h"
+
+namespace NBT_Lib {
+	//Coroutine type of the asynchronous functions. A task starts when it is awaited, when start is called or when it is scheduled
+	//on an executor, and resumes the coroutine awaiting it once it completes. Destroying a task destroys its coroutine.
+	template<typename valueType = void>
+	class NBT_Task {
+		//Resumes the awaiting coroutine when the task completes.
+		struct FinalAwaiter {
+			bool await_ready() noexcept {
+				return false;
+			}
+			template<typename promiseType>
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<promiseType> handle) noexcept {
+				const std::coroutine_handle<> continuation{ handle.promise().continuation };
+				return continuation ? continuation : std::noop_coroutine();
+			}
+			void await_resume() noexcept {
+			}
+		};
+		struct PromiseBase {
+			std::coroutine_handle<> continuation;
+			std::exception_ptr error;
+
+			std::suspend_always initial_suspend() noexcept {
+				return {};
+			}
+			FinalAwaiter final_suspend() noexcept {
+				return {};
+			}
+			void unhandled_exception() noexcept {
+				error = std::current_exception();
+			}
+		};
+		struct ValuePromise : PromiseBase {
+			std::optional<valueType> value;
+			void return_value(valueType result) {
+				value.emplace(std::move(result));
+			}
+		};
+		struct VoidPromise : PromiseBase {
+			void return_void() noexcept {
+			}
+		};
+
+	public:
+		struct promise_type : std::conditional_t<std::is_void_v<valueType>, VoidPromise, ValuePromise> {
+			NBT_Task get_return_object() {
+				return NBT_Task{ std::coroutine_handle<promise_type>::from_promise(*this) };
+			}
+		};
+
+	private:
+		std::coroutine_handle<promise_type> handle;
+
+		explicit NBT_Task(std::coroutine_handle<promise_type> handle)
+			: handle{ handle } {
+		}
+
+		valueType result() {
+			if (handle.promise().error)
+				std::rethrow_exception(handle.promise().error);
+			if constexpr (!std::is_void_v<valueType>)
+				return std::move(*handle.promise().value);
+		}
+
+	public:
+		NBT_Task(NBT_Task&& other) noexcept
+			: handle{ std::exchange(other.handle, {}) } {
+		}
+		NBT_Task& operator=(NBT_Task&& other) noexcept {
+			if (this != &other) {
+				if (handle)
+					handle.destroy();
+				handle = std::exchange(other.handle, {});
+			}
+			return *this;
+		}
+		~NBT_Task() {
+			if (handle)
+				handle.destroy();
+		}
+
+		bool await_ready() const noexcept {
+			return handle.done();
+		}
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+			handle.promise().continuation = awaiting;
+			return handle;
+		}
+		valueType await_resume() {
+			return result();
+		}
+
+		//Runs the task on the calling thread until it first suspends.
+		void start() {
+			handle.resume();
+		}
+		[[nodiscard]]
+		std::coroutine_handle<> getHandle() const {
+			return handle;
+		}
+		[[nodiscard]]
+		bool done() const {
+			return handle.done();
+		}
+		//Returns the result of a completed task, or rethrows the exception it ended with.
+		valueType get() {
+			if (!handle.done())
+				throw std::runtime_error("Result of an NBT_Task requested before the task completed.");
+			return result();
+		}
+	};
+
+	//Input of an asynchronous decode, e.g. the bytes arriving on a socket. The decoder suspends whenever it needs more data than is
+	//buffered and is resumed when enough has been pushed, so only the part of the document being decoded is ever held.
+	//Without a scheduler the decoder is resumed inside push and runs until it needs more data. With a scheduler it is resumed through it,
+	//and producers running as coroutines can await write, which suspends them while the buffer holds capacity bytes or more and the decoder
+	//is not waiting for data. The decoder may need up to 64 KiB at once, e.g. for a long string, so more than capacity can be buffered.
+	//Not thread safe, the decoder and producers have to run on the same thread or executor.
+	class NBT_AsyncInput {
+	public:
+		using Scheduler = std::function<void(std::coroutine_handle<>)>;
+
+	private:
+		std::vector<byte> buffer;
+		size_t readOffset{ 0u };
+		size_t capacity;
+		Scheduler scheduler;
+		std::coroutine_handle<> waitingReader;
+		size_t needed{ 0u };
+		std::coroutine_handle<> waitingWriter;
+		bool closed{ false };
+		bool readerFinished{ false };
+
+		void resume(std::coroutine_handle<> handle) {
+			if (scheduler)
+				scheduler(handle);
+			else
+				handle.resume();
+		}
+		void resumeReader() {
+			if (waitingReader && (getBuffered() >= needed || closed))
+				resume(std::exchange(waitingReader, {}));
+		}
+
+	public:
+		explicit NBT_AsyncInput(size_t capacity = 1u << 16u, Scheduler scheduler = {})
+			: capacity{ capacity }, scheduler{ std::move(scheduler) } {
+		}
+		NBT_AsyncInput(const NBT_AsyncInput&) = delete;
+		NBT_AsyncInput& operator=(const NBT_AsyncInput&) = delete;
+
+		//Adds data regardless of how much is buffered and resumes the decoder if it can continue.
+		void push(const void* data, size_t size);
+		//Marks the end of the input, a decoder still waiting for data fails with std::out_of_range.
+		void close() {
+			closed = true;
+			resumeReader();
+		}
+
+		//Adds data, awaiting the result suspends the producer until the decoder has consumed enough of the buffered data.
+		//Only suspends with a scheduler, without one the decoder has already consumed the data when push returns.
+		[[nodiscard]]
+		auto write(const void* data, size_t size) {
+			struct WriteAwaiter {
+				NBT_AsyncInput& input;
+				bool await_ready() const noexcept {
+					return !input.scheduler || input.readerFinished || input.waitingReader || input.getBuffered() < input.capacity;
+				}
+				void await_suspend(std::coroutine_handle<> handle) noexcept {
+					input.waitingWriter = handle;
+				}
+				void await_resume() noexcept {
+				}
+			};
+			push(data, size);
+			return WriteAwaiter{ *this };
+		}
+
+		[[nodiscard]]
+		size_t getBuffered() const {
+			return buffer.size() - readOffset;
+		}
+		[[nodiscard]]
+		bool isClosed() const {
+			return closed;
+		}
+
+		//The following are used by the decoder.
+
+		//Suspends until at least size bytes are buffered or the input is closed, throws std::out_of_range if it was closed before that.
+		[[nodiscard]]
+		auto need(size_t size) {
+			struct NeedAwaiter {
+				NBT_AsyncInput& input;
+				size_t size;
+				bool await_ready() const noexcept {
+					return input.getBuffered() >= size || input.closed;
+				}
+				void await_suspend(std::coroutine_handle<> handle) {
+					input.waitingReader = handle;
+					input.needed = size;
+					if (input.waitingWriter) //The decoder can not continue before the producer adds more.
+						input.resume(std::exchange(input.waitingWriter, {}));
+				}
+				void await_resume() const {
+					if (input.getBuffered() < size)
+						throw std::out_of_range("Data ran out before the end of the NBT document.");
+				}
+			};
+			return NeedAwaiter{ *this, size };
+		}
+		[[nodiscard]]
+		byte* data() {
+			return buffer.data() + readOffset;
+		}
+		void consume(size_t size) {
+			readOffset += size;
+			if (waitingWriter && getBuffered() < capacity)
+				resume(std::exchange(waitingWriter, {}));
+		}
+		//Called when decoding ends, successfully or not. Data after the document stays buffered and producers no longer wait.
+		void finishReading() {
+			readerFinished = true;
+			waitingReader = {};
+			if (waitingWriter)
+				resume(std::exchange(waitingWriter, {}));
+		}
+	};
+
+	//Runs coroutines on the thread calling run, in the order they were scheduled. For tests and single threaded event loops.
+	class NBT_LocalExecutor {
+		std::deque<std::coroutine_handle<>> ready;
+
+	public:
+		void schedule(std::coroutine_handle<> handle) {
+			ready.push_back(handle);
+		}
+		//The task has to stay alive until it completes.
+		template<typename valueType>
+		void spawn(NBT_Task<valueType>& task) {
+			schedule(task.getHandle());
+		}
+		[[nodiscard]]
+		NBT_AsyncInput::Scheduler getScheduler() {
+			return [this](std::coroutine_handle<> handle) {
+				schedule(handle);
+			};
+		}
+
+		//Awaitable rescheduling the awaiting coroutine behind the ones already scheduled.
+		[[nodiscard]]
+		auto yield() {
+			struct YieldAwaiter {
+				NBT_LocalExecutor& executor;
+				bool await_ready() const noexcept {
+					return false;
+				}
+				void await_suspend(std::coroutine_handle<> handle) {
+					executor.schedule(handle);
+				}
+				void await_resume() noexcept {
+				}
+			};
+			return YieldAwaiter{ *this };
+		}
+
+		//Resumes scheduled coroutines until none is left and returns how many were resumed.
+		size_t run() {
+			size_t resumed{ 0u };
+			while (!ready.empty()) {
+				const std::coroutine_handle<> handle{ ready.front() };
+				ready.pop_front();
+				handle.resume();
+				++resumed;
+			}
+			return resumed;
+		}
+	};
+
+	//Produces the encoded document in chunks, each chunk is only encoded once the previous one has been taken:
+	//	for (NBT_ChunkGenerator chunks{ encodeAsync(&root) }; chunks.next();)
+	//		co_await send(chunks.chunk());
+	class NBT_ChunkGenerator {
+	public:
+		struct promise_type {
+			std::span<const byte> chunk;
+			std::exception_ptr error;
+
+			NBT_ChunkGenerator get_return_object() {
+				return NBT_ChunkGenerator{ std::coroutine_handle<promise_type>::from_promise(*this) };
+			}
+			std::suspend_always initial_suspend() noexcept {
+				return {};
+			}
+			std::suspend_always final_suspend() noexcept {
+				return {};
+			}
+			std::suspend_always yield_value(std::span<const byte> nextChunk) noexcept {
+				chunk = nextChunk;
+				return {};
+			}
+			void return_void() noexcept {
+			}
+			void unhandled_exception() noexcept {
+				error = std::current_exception();
+			}
+		};
+
+	private:
+		std::coroutine_handle<promise_type> handle;
+
+		explicit NBT_ChunkGenerator(std::coroutine_handle<promise_type> handle)
+			: handle{ handle } {
+		}
+
+	public:
+		NBT_ChunkGenerator(NBT_ChunkGenerator&& other) noexcept
+			: handle{ std::exchange(other.handle, {}) } {
+		}
+		NBT_ChunkGenerator& operator=(NBT_ChunkGenerator&& other) noexcept {
+			if (this != &other) {
+				if (handle)
+					handle.destroy();
+				handle = std::exchange(other.handle, {});
+			}
+			return *this;
+		}
+		~NBT_ChunkGenerator() {
+			if (handle)
+				handle.destroy();
+		}
+
+		//Encodes the next chunk, returns false once the whole document has been produced. Rethrows exceptions thrown while encoding.
+		bool next() {
+			if (handle.done())
+				return false;
+			handle.resume();
+			if (handle.promise().error)
+				std::rethrow_exception(std::exchange(handle.promise().error, {}));
+			return !handle.done();
+		}
+		//The current chunk, valid until next is called.
+		[[nodiscard]]
+		std::span<const byte> chunk() const {
+			return handle.promise().chunk;
+		}
+	};
+
+	//Decodes an uncompressed document as its data arrives, the result matches parseNBT.
+	//Throws std::out_of_range if the input is closed before the document is complete and std::runtime_error if it is malformed or nested deeper than NBT_MAX_DEPTH.
+	//The input and memRes have to outlive the task.
+	NBT_Task<Compound_Tag> decodeAsync(NBT_AsyncInput& input, std::pmr::memory_resource* memRes);
+
+	//Encodes a document in chunks of chunkSize bytes, the last chunk may be shorter. The root has to outlive the generator and must not be modified while it is used.
+	NBT_ChunkGenerator encodeAsync(const Compound_Tag* root, size_t chunkSize = 1u << 16u);
+}
@@ -0,0 +1,108 @@
+#include "NBT_LibBatch.h"
+#include <thread>
+
+namespace NBT_Lib {
+	namespace {
+		constexpr size_t RANGES_PER_THREAD{ 4u };
+		//Below this many documents per thread, handing them to the workers costs more than encoding in parallel saves.
+		constexpr size_t MIN_DOCUMENTS_PER_THREAD{ 32u };
+
+		constexpr size_t prefixSize(FrameFormat framing) {
+			switch (framing) {
+				using enum FrameFormat;
+			case UInt32:
+				return sizeof(uint32_t);
+			case VarInt:
+				return 5u; //Room for the longest VarInt, the prefix is moved down once the length is known.
+			default:
+				return 0u;
+			}
+		}
+
+		//Appends the frame of a document to buffer.
+		void encodeFrame(const Compound_Tag* root, FrameFormat framing, std::vector<byte>& buffer) {
+			const size_t start{ buffer.size() };
+			const size_t reserved{ prefixSize(framing) };
+			buffer.resize(start + reserved);
+			buildBinaryNBTFile(root, buffer);
+
+			const size_t length{ buffer.size() - start - reserved };
+			if (framing == FrameFormat::UInt32) {
+				if (length > UINT32_MAX)
+					throw std::runtime_error("Document of " + std::to_string(length) + " bytes is too long for a uint32 length prefix.");
+				const uint32_t flippedLength{ byteswap(static_cast<uint32_t>(length)) };
+				memcpy(buffer.data() + start, &flippedLength, sizeof(flippedLength));
+			}
+			else if (framing == FrameFormat::VarInt) {
+				if (length > size_t(INT32_MAX))
+					throw std::runtime_error("Document of " + std::to_string(length) + " bytes is too long for a VarInt length prefix.");
+				byte prefix[5];
+				size_t prefixLength{ 0u };
+				uint32_t remaining{ static_cast<uint32_t>(length) };
+				do {
+					byte b{ static_cast<byte>(remaining & 0x7fu) };
+					remaining >>= 7u;
+					if (remaining != 0u)
+						b |= byte{ 0x80u };
+					prefix[prefixLength++] = b;
+				} while (remaining != 0u);
+
+				memmove(buffer.data() + start + prefixLength, buffer.data() + start + reserved, length);
+				memcpy(buffer.data() + start, prefix, prefixLength);
+				buffer.resize(start + prefixLength + length);
+			}
+		}
+	}
+
+	void NBT_BatchEncoder::encode(std::span<const Compound_Tag* const> roots, NBT_EncodedBatch& out) {
+		out.data.clear();
+		out.offsets.resize(roots.size() + 1u);
+
+		const size_t maxThreads{ threadCount != 0u ? threadCount : std::max(1u, std::thread::hardware_concurrency()) };
+		const size_t threads{ std::min(maxThreads, roots.size() / MIN_DOCUMENTS_PER_THREAD) };
+		if (threads <= 1u) {
+			for (size_t i = 0u; i < roots.size(); ++i) {
+				out.offsets[i] = out.data.size();
+				encodeFrame(roots[i], framing, out.data);
+			}
+			out.offsets.back() = out.data.size();
+			return;
+		}
+
+		//Each range of documents is encoded into its own buffer with offsets relative to it, which are then concatenated in order.
+		const size_t rangeCount{ threads * RANGES_PER_THREAD };
+		if (rangeBuffers.size() < rangeCount)
+			rangeBuffers.resize(rangeCount);
+		if (!pool)
+			pool = std::make_unique<WorkerPool>(maxThreads);
+		parallelFor(*pool, rangeCount, [&](size_t range, size_t) {
+			const size_t first{ roots.size() * range / rangeCount };
+			const size_t last{ roots.size() * (range + 1u) / rangeCount };
+			std::vector<byte>& buffer{ rangeBuffers[range] };
+			buffer.clear();
+			for (size_t i = first; i < last; ++i) {
+				out.offsets[i] = buffer.size();
+				encodeFrame(roots[i], framing, buffer);
+			}
+		});
+
+		size_t totalSize{ 0u };
+		for (size_t range = 0u; range < rangeCount; ++range)
+			totalSize += rangeBuffers[range].size();
+		out.data.resize(totalSize);
+
+		size_t rangeOffset{ 0u };
+		for (size_t range = 0u; range < rangeCount; ++range) {
+			const size_t first{ roots.size() * range / rangeCount };
+			const size_t last{ roots.size() * (range + 1u) / rangeCount };
+			for (size_t i = first; i < last; ++i)
+				out.offsets[i] += rangeOffset;
+
+			const std::vector<byte>& buffer{ rangeBuffers[range] };
+			if (!buffer.empty())
+				memcpy(out.data.data() + rangeOffset, buffer.data(), buffer.size());
+			rangeOffset += buffer.size();
+		}
+		out.offsets.back() = totalSize;
+	}
+}
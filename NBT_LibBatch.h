@@ -0,0 +1,55 @@
+#pragma once
+#include <vector>
+#include <span>
+#include <memory>
+
+#include "NBT_Lib.h"
+
+namespace NBT_Lib {
+	enum class FrameFormat {
+		None,	//Documents are concatenated, use the offsets to find them.
+		UInt32,	//Each document is preceded by its length as a big endian uint32.
+		VarInt	//Each document is preceded by its length as a VarInt, like packets of the Minecraft protocol.
+	};
+
+	struct NBT_EncodedBatch {
+		std::vector<byte> data;
+		std::vector<size_t> offsets; //offsets[i] is where the frame of document i starts in data, the last entry is data.size().
+
+		[[nodiscard]]
+		size_t size() const {
+			return offsets.empty() ? 0u : offsets.size() - 1u;
+		}
+		//The frame of document i, including its length prefix.
+		[[nodiscard]]
+		std::span<const byte> frame(size_t i) const {
+			return { data.data() + offsets[i], offsets[i + 1u] - offsets[i] };
+		}
+	};
+
+	//Encodes many documents into one contiguous buffer. The encoder keeps its scratch buffers and threads between calls, and together with
+	//reusing the output batch this means encoding the same amount of data again, e.g. every tick, does not allocate or start threads.
+	class NBT_BatchEncoder {
+		FrameFormat framing;
+		size_t threadCount;
+		std::vector<std::vector<byte>> rangeBuffers; //Scratch of each range of documents encoded in parallel.
+		std::unique_ptr<WorkerPool> pool; //Started by the first parallel encode and kept for the following ones.
+
+	public:
+		//Documents are encoded in parallel on up to threadCount threads (0 = hardware concurrency) when there are enough of them.
+		explicit NBT_BatchEncoder(FrameFormat framing = FrameFormat::None, size_t threadCount = 1u)
+			: framing{ framing }, threadCount{ threadCount } {
+		}
+
+		//Replaces the contents of out with the frames of the roots, in order. out's capacity is reused.
+		//Throws std::runtime_error if a document is too long for its length prefix or contains a string that can not be encoded.
+		void encode(std::span<const Compound_Tag* const> roots, NBT_EncodedBatch& out);
+
+		[[nodiscard]]
+		NBT_EncodedBatch encode(std::span<const Compound_Tag* const> roots) {
+			NBT_EncodedBatch out;
+			encode(roots, out);
+			return out;
+		}
+	};
+}
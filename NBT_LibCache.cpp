@@ -0,0 +1,142 @@
+#include "NBT_LibCache.h"
+#include <algorithm>
+
+#include "NBT_LibValidate.h"
+
+namespace NBT_Lib {
+	namespace {
+		//Validates the document before parsing and returns the memory the parsed tree needs, so the arena can be allocated in one piece.
+		size_t validatedMemoryRequirement(const void* dataPtr, size_t dataSize) {
+			const NBT_ValidationResult validation{ validateNBT(dataPtr, dataSize) };
+			if (!validation)
+				throw std::runtime_error(std::string("Invalid NBT document: ") + validation.error);
+			//Leave room for alignment padding between the arena's allocations, which the estimate does not include.
+			return validation.requiredMemory + validation.requiredMemory / 4u + 256u;
+		}
+	}
+
+	NBT_Document::NBT_Document(const void* dataPtr, size_t dataSize)
+		: arena{ validatedMemoryRequirement(dataPtr, dataSize), &accounting }
+		, root{ parseNBT(const_cast<void*>(dataPtr), dataSize, &arena) } {
+	}
+
+	DocumentCache::DocumentCache(size_t maxMemory, Decoder decoder)
+		: maxMemory{ maxMemory }, decoder{ std::move(decoder) } {
+	}
+
+	DocumentHandle DocumentCache::lookup(const ContentKey& key) {
+		std::scoped_lock lock{ mutex };
+		const auto it{ entries.find(key) };
+		if (it == entries.end()) {
+			++stats.misses;
+			return nullptr;
+		}
+		++stats.hits;
+		lru.splice(lru.begin(), lru, it->second);
+		return it->second->document;
+	}
+
+	void DocumentCache::evictToFit() {
+		//The most recently used entry is kept even if it alone exceeds the limit, it was only inserted because it fits.
+		while (stats.memoryUsage > maxMemory && lru.size() > 1u) {
+			Entry& entry{ lru.back() };
+			for (const std::string& file : entry.files)
+				fileIndex.erase(file);
+			entries.erase(entry.key);
+			stats.memoryUsage -= entry.memoryUsage;
+			++stats.evictions;
+			lru.pop_back();
+		}
+	}
+
+	DocumentHandle DocumentCache::insert(const ContentKey& key, DocumentHandle document, const std::string* filePath, const FileEntry* fileEntry) {
+		std::scoped_lock lock{ mutex };
+		auto it{ entries.find(key) };
+		if (it != entries.end()) { //Another thread parsed the same document in the meantime.
+			lru.splice(lru.begin(), lru, it->second);
+			document = it->second->document;
+		}
+		else {
+			const size_t memoryUsage{ document->getMemoryUsage() };
+			if (memoryUsage > maxMemory)
+				return document; //Too large to ever be cached.
+
+			lru.push_front({ key, document, memoryUsage, {} });
+			it = entries.emplace(key, lru.begin()).first;
+			stats.memoryUsage += memoryUsage;
+			evictToFit();
+		}
+
+		if (filePath) {
+			//Only files whose document is actually cached are remembered.
+			const auto fileIt{ fileIndex.find(*filePath) };
+			if (fileIt != fileIndex.end() && !(fileIt->second.key == key)) {
+				//The file's content changed, it no longer refers to the old entry.
+				const auto oldIt{ entries.find(fileIt->second.key) };
+				if (oldIt != entries.end())
+					std::erase(oldIt->second->files, *filePath);
+			}
+			std::vector<std::string>& files{ it->second->files };
+			if (std::find(files.begin(), files.end(), *filePath) == files.end())
+				files.push_back(*filePath);
+			fileIndex[*filePath] = { fileEntry->lastWriteTime, fileEntry->fileSize, key };
+		}
+		return document;
+	}
+
+	DocumentHandle DocumentCache::getImpl(const byte* data, size_t size, const std::string* filePath, const FileEntry* fileEntry) {
+		const ContentKey key{ hashBytes(data, size), size };
+
+		DocumentHandle document{ lookup(key) };
+		if (!document) {
+			if (decoder) {
+				std::vector<byte> decoded;
+				decoder(data, size, decoded);
+				document = std::make_shared<const NBT_Document>(decoded.data(), decoded.size());
+			}
+			else {
+				document = std::make_shared<const NBT_Document>(data, size);
+			}
+		}
+		return insert(key, std::move(document), filePath, fileEntry);
+	}
+
+	DocumentHandle DocumentCache::get(const void* data, size_t size) {
+		return getImpl(static_cast<const byte*>(data), size, nullptr, nullptr);
+	}
+
+	DocumentHandle DocumentCache::getFile(const std::filesystem::path& path) {
+		const std::string filePath{ std::filesystem::absolute(path).lexically_normal().string() };
+		FileEntry fileEntry{ std::filesystem::last_write_time(path), std::filesystem::file_size(path), {} };
+		{
+			std::scoped_lock lock{ mutex };
+			const auto fileIt{ fileIndex.find(filePath) };
+			if (fileIt != fileIndex.end() && fileIt->second.lastWriteTime == fileEntry.lastWriteTime && fileIt->second.fileSize == fileEntry.fileSize) {
+				const auto it{ entries.find(fileIt->second.key) };
+				if (it != entries.end()) {
+					++stats.hits;
+					lru.splice(lru.begin(), lru, it->second);
+					return it->second->document;
+				}
+			}
+		}
+
+		const std::vector<byte> data{ loadFileBytes(path) };
+		return getImpl(data.data(), data.size(), &filePath, &fileEntry);
+	}
+
+	void DocumentCache::clear() {
+		std::scoped_lock lock{ mutex };
+		lru.clear();
+		entries.clear();
+		fileIndex.clear();
+		stats.memoryUsage = 0u;
+	}
+
+	DocumentCacheStats DocumentCache::getStats() const {
+		std::scoped_lock lock{ mutex };
+		DocumentCacheStats result{ stats };
+		result.entries = entries.size();
+		return result;
+	}
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <list>
+#include <unordered_map>
+#include <functional>
+#include <filesystem>
+
+#include "NBT_Lib.h"
+#include "NBT_LibMemory.h"
+#include "NBT_LibHash.h"
+
+namespace NBT_Lib {
+	//A parsed NBT document together with the memory its tree was allocated from.
+	class NBT_Document {
+		BudgetMemoryResource accounting{ SIZE_MAX, std::pmr::new_delete_resource() }; //Measures what the arena takes from the heap.
+		std::pmr::monotonic_buffer_resource arena;
+		Compound_Tag root;
+
+	public:
+		//Validates and parses an uncompressed NBT document, throws std::runtime_error if it is malformed.
+		NBT_Document(const void* dataPtr, size_t dataSize);
+		NBT_Document(const NBT_Document&) = delete;
+		NBT_Document& operator=(const NBT_Document&) = delete;
+
+		[[nodiscard]]
+		const Compound_Tag& getRoot() const {
+			return root;
+		}
+		//Heap memory held by the document.
+		[[nodiscard]]
+		size_t getMemoryUsage() const {
+			return accounting.getUsed() + sizeof(NBT_Document);
+		}
+	};
+
+	//Documents are shared and immutable, they stay valid after being evicted until the last handle is released.
+	using DocumentHandle = std::shared_ptr<const NBT_Document>;
+
+	struct DocumentCacheStats {
+		uint64_t hits{ 0u };
+		uint64_t misses{ 0u };
+		uint64_t evictions{ 0u };
+		size_t entries{ 0u };
+		size_t memoryUsage{ 0u }; //Sum of NBT_Document::getMemoryUsage of the cached documents.
+	};
+
+	//Thread safe LRU cache of parsed documents keyed by a hash of the input bytes, bounded by the memory of the cached documents.
+	//Documents on a miss are parsed outside of the lock, so lookups of other documents are never blocked by parsing.
+	class DocumentCache {
+	public:
+		//Turns the input bytes into an uncompressed NBT document, e.g. by decompressing them.
+		using Decoder = std::function<void(const byte* data, size_t size, std::vector<byte>& out)>;
+
+	private:
+		struct ContentKey {
+			NBT_Hash128 hash;
+			size_t size;
+			bool operator==(const ContentKey& other) const = default;
+		};
+		struct ContentKeyHash {
+			size_t operator()(const ContentKey& key) const {
+				return static_cast<size_t>(key.hash.low);
+			}
+		};
+		struct Entry {
+			ContentKey key;
+			DocumentHandle document;
+			size_t memoryUsage;
+			std::vector<std::string> files; //Paths in fileIndex referring to this entry.
+		};
+		struct FileEntry {
+			std::filesystem::file_time_type lastWriteTime;
+			uintmax_t fileSize;
+			ContentKey key;
+		};
+
+		size_t maxMemory;
+		Decoder decoder;
+
+		mutable std::mutex mutex;
+		std::list<Entry> lru; //Most recently used first.
+		std::unordered_map<ContentKey, std::list<Entry>::iterator, ContentKeyHash> entries;
+		std::unordered_map<std::string, FileEntry> fileIndex;
+		DocumentCacheStats stats;
+
+		DocumentHandle lookup(const ContentKey& key);
+		DocumentHandle insert(const ContentKey& key, DocumentHandle document, const std::string* filePath, const FileEntry* fileEntry);
+		void evictToFit();
+		DocumentHandle getImpl(const byte* data, size_t size, const std::string* filePath, const FileEntry* fileEntry);
+
+	public:
+		//If no decoder is given the input must be uncompressed NBT.
+		explicit DocumentCache(size_t maxMemory, Decoder decoder = {});
+
+		//Returns the document for the given input bytes, decoding and parsing them only if they are not cached.
+		[[nodiscard]]
+		DocumentHandle get(const void* data, size_t size);
+
+		//Returns the document stored in a file. While the file's size and modification time are unchanged
+		//the file is not even read again, otherwise it is read and looked up by content.
+		[[nodiscard]]
+		DocumentHandle getFile(const std::filesystem::path& path);
+
+		void clear();
+
+		[[nodiscard]]
+		DocumentCacheStats getStats() const;
+		[[nodiscard]]
+		size_t getMaxMemory() const {
+			return maxMemory;
+		}
+	};
+}
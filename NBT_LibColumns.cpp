@@ -0,0 +1,232 @@
+#include "NBT_LibColumns.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace NBT_Lib {
+	namespace {
+		constexpr bool isColumnType(TagID id) {
+			return (id >= TagID::Byte && id <= TagID::Double) || id == TagID::String;
+		}
+
+		//More ranges than threads, so threads finishing early can pick up remaining work.
+		constexpr size_t RANGES_PER_THREAD{ 8u };
+
+		NBT_RawPathSet makePathSet(const std::vector<NBT_ColumnSpec>& specs) {
+			std::vector<std::string_view> paths;
+			paths.reserve(specs.size());
+			for (const NBT_ColumnSpec& spec : specs)
+				paths.push_back(spec.path);
+			return NBT_RawPathSet{ paths };
+		}
+	}
+
+	NBT_Column::NBT_Column(const NBT_ColumnSpec& spec)
+		: path{ spec.path }, type{ spec.type } {
+
+		switch (type) {
+			using enum TagID;
+		case Byte:
+			data.emplace<std::vector<int8_t>>();
+			break;
+		case Short:
+			data.emplace<std::vector<int16_t>>();
+			break;
+		case Int:
+			data.emplace<std::vector<int32_t>>();
+			break;
+		case Long:
+			data.emplace<std::vector<int64_t>>();
+			break;
+		case Float:
+			data.emplace<std::vector<float>>();
+			break;
+		case Double:
+			data.emplace<std::vector<double>>();
+			break;
+		case String:
+			data.emplace<NBT_StringColumn>();
+			break;
+		default:
+			throw std::invalid_argument("Column " + path + " has type " + TagIDToString(type) + ", only numbers and strings can be extracted.");
+		}
+	}
+
+	void NBT_Column::appendValue(const byte* payload, size_t available, bool present) {
+		validity.push_back(present ? 1u : 0u);
+		if (!present)
+			++nullCount;
+
+		std::visit([&](auto& values) {
+			using ColumnType = std::decay_t<decltype(values)>;
+			if constexpr (std::is_same_v<ColumnType, NBT_StringColumn>) {
+				if (present) {
+					if (available < sizeof(uint16_t))
+						throw std::out_of_range("Data ran out while reading a string.");
+					const size_t length{ copyAndFlipBytes<uint16_t>(const_cast<byte*>(payload)) };
+					if (available - sizeof(uint16_t) < length)
+						throw std::out_of_range("Data ran out while reading a string.");
+					const char* chars{ reinterpret_cast<const char*>(payload + sizeof(uint16_t)) };
+					bool needsConversion;
+					const size_t utf8Length{ scanMUTF8(chars, length, needsConversion) };
+					if (utf8Length == SIZE_MAX)
+						throw std::runtime_error("Invalid Modified UTF-8 in string.");
+					if (needsConversion) {
+						const size_t offset{ values.chars.size() };
+						values.chars.resize(offset + utf8Length);
+						convertMUTF8ToUTF8(chars, length, values.chars.data() + offset);
+					}
+					else {
+						values.chars.append(chars, length);
+					}
+				}
+				values.offsets.push_back(values.chars.size());
+			}
+			else {
+				using valueType = typename ColumnType::value_type;
+				values.push_back(present ? copyAndFlipBytes<valueType>(const_cast<byte*>(payload)) : valueType{});
+			}
+		}, data);
+	}
+
+	void NBT_Column::append(const NBT_Column& other) {
+		validity.insert(validity.end(), other.validity.begin(), other.validity.end());
+		nullCount += other.nullCount;
+
+		std::visit([&](auto& values) {
+			using ColumnType = std::decay_t<decltype(values)>;
+			const ColumnType& otherValues{ std::get<ColumnType>(other.data) };
+			if constexpr (std::is_same_v<ColumnType, NBT_StringColumn>) {
+				const size_t base{ values.chars.size() };
+				values.chars += otherValues.chars;
+				for (size_t i = 1u; i < otherValues.offsets.size(); ++i)
+					values.offsets.push_back(base + otherValues.offsets[i]);
+			}
+			else {
+				values.insert(values.end(), otherValues.begin(), otherValues.end());
+			}
+		}, data);
+	}
+
+	void NBT_Column::truncate(size_t rows) {
+		if (rows >= validity.size())
+			return;
+		nullCount -= static_cast<size_t>(std::count(validity.begin() + rows, validity.end(), uint8_t{ 0u }));
+		validity.resize(rows);
+
+		std::visit([&](auto& values) {
+			using ColumnType = std::decay_t<decltype(values)>;
+			if constexpr (std::is_same_v<ColumnType, NBT_StringColumn>) {
+				values.offsets.resize(rows + 1u);
+				values.chars.resize(values.offsets.back());
+			}
+			else {
+				values.resize(rows);
+			}
+		}, data);
+	}
+
+	const NBT_StringColumn& NBT_Column::strings() const {
+		if (type != TagID::String)
+			throw std::runtime_error("Type mismatch, column " + path + " holds " + TagIDToString(type) + " values.");
+		return std::get<NBT_StringColumn>(data);
+	}
+
+	void NBT_ColumnBatch::append(const NBT_ColumnBatch& other, size_t documentOffset) {
+		if (other.columns.size() != columns.size())
+			throw std::invalid_argument("Cannot append a batch with different columns.");
+		for (size_t i = 0u; i < columns.size(); ++i)
+			columns[i].append(other.columns[i]);
+		for (const size_t index : other.documentIndex)
+			documentIndex.push_back(index + documentOffset);
+		for (const size_t index : other.failedDocuments)
+			failedDocuments.push_back(index + documentOffset);
+	}
+
+	void NBT_ColumnBatch::truncate(size_t rows) {
+		for (NBT_Column& column : columns)
+			column.truncate(rows);
+		if (rows < documentIndex.size())
+			documentIndex.resize(rows);
+	}
+
+	NBT_ColumnExtractor::NBT_ColumnExtractor(std::vector<NBT_ColumnSpec> columns, std::string recordPath)
+		: specs{ std::move(columns) }, recordPath{ std::move(recordPath) }, paths{ makePathSet(specs) } {
+
+		for (const NBT_ColumnSpec& spec : specs) {
+			if (!isColumnType(spec.type))
+				throw std::invalid_argument("Column " + spec.path + " has type " + TagIDToString(spec.type) + ", only numbers and strings can be extracted.");
+		}
+		const std::string_view record{ this->recordPath };
+		(void)NBT_RawPathSet{ std::span{ &record, 1u } }; //Rejects a malformed record path before any document is read.
+	}
+
+	NBT_ColumnBatch NBT_ColumnExtractor::makeEmptyBatch() const {
+		NBT_ColumnBatch batch;
+		batch.columns.reserve(specs.size());
+		for (const NBT_ColumnSpec& spec : specs)
+			batch.columns.push_back(NBT_Column{ spec });
+		return batch;
+	}
+
+	void NBT_ColumnExtractor::extractDocument(const std::span<const byte>& document, size_t documentIndex, NBT_ColumnBatch& batch) const {
+		byte* const data{ const_cast<byte*>(document.data()) }; //Only read, the raw search functions take mutable pointers for patching.
+		byte* const end{ data + document.size() };
+
+		//Adds the row of a record and returns the size of its payload.
+		std::vector<NBT_RawTag> tags(specs.size());
+		const auto addRow{ [&](byte* record) {
+			const size_t recordSize{ findRawEntries(record, size_t(end - record), paths, tags) };
+			for (size_t i = 0u; i < specs.size(); ++i) {
+				const bool present{ tags[i] && tags[i].type == specs[i].type };
+				batch.columns[i].appendValue(tags[i].payload, present ? size_t(end - tags[i].payload) : 0u, present);
+			}
+			batch.documentIndex.push_back(documentIndex);
+			return recordSize;
+		} };
+
+		const size_t firstRow{ batch.rowCount() };
+		try {
+			const NBT_RawTag records{ findRawTag(data, document.size(), recordPath) };
+			if (records.type == TagID::Compound) {
+				addRow(records.payload);
+			}
+			else if (records.type == TagID::List && records.elementType == TagID::Compound) {
+				byte* record{ records.payload };
+				for (size_t i = 0u; i < records.count; ++i)
+					record += addRow(record);
+			}
+		}
+		catch (const std::out_of_range&) {
+			batch.truncate(firstRow);
+			batch.failedDocuments.push_back(documentIndex);
+		}
+		catch (const std::runtime_error&) {
+			batch.truncate(firstRow);
+			batch.failedDocuments.push_back(documentIndex);
+		}
+	}
+
+	NBT_ColumnBatch NBT_ColumnExtractor::extract(std::span<const std::span<const byte>> documents, size_t threadCount) const {
+		if (threadCount == 0u)
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+		//Each range of documents is extracted into its own batch, which are concatenated in order afterwards.
+		const size_t rangeCount{ std::min(documents.size(), threadCount * RANGES_PER_THREAD) };
+		std::vector<NBT_ColumnBatch> partials(rangeCount);
+		parallelFor(rangeCount, threadCount, [&](size_t range, size_t) {
+			const size_t first{ documents.size() * range / rangeCount };
+			const size_t last{ documents.size() * (range + 1u) / rangeCount };
+			NBT_ColumnBatch& batch{ partials[range] };
+			batch = makeEmptyBatch();
+			for (size_t i = first; i < last; ++i)
+				extractDocument(documents[i], i, batch);
+		});
+
+		if (partials.size() == 1u)
+			return std::move(partials.front());
+		NBT_ColumnBatch result{ makeEmptyBatch() };
+		for (const NBT_ColumnBatch& partial : partials)
+			result.append(partial);
+		return result;
+	}
+}
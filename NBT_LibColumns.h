@@ -0,0 +1,126 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <string_view>
+#include <span>
+#include <variant>
+#include <cstddef>
+#include <cstdint>
+
+#include "NBT_Lib.h"
+#include "NBT_LibPatch.h"
+
+namespace NBT_Lib {
+	struct NBT_ColumnSpec {
+		std::string path; //Relative to the record, e.g. "Pos[0]" or "Inventory[0].Count".
+		TagID type{ TagID::End }; //A number type or String. Values of any other type are stored as null.
+	};
+
+	//Strings of a column, the characters of all rows are stored in one arena and row i spans [offsets[i], offsets[i + 1]).
+	//Strings are converted from the MUTF-8 of the NBT data to UTF-8.
+	struct NBT_StringColumn {
+		std::vector<size_t> offsets{ 0u };
+		std::string chars;
+
+		[[nodiscard]]
+		std::string_view operator[](size_t row) const {
+			return std::string_view{ chars }.substr(offsets[row], offsets[row + 1u] - offsets[row]);
+		}
+	};
+
+	//Values of one field for every row of an NBT_ColumnBatch. Null rows hold 0 or an empty string.
+	class NBT_Column {
+		friend class NBT_ColumnExtractor;
+		friend struct NBT_ColumnBatch;
+
+		std::string path;
+		TagID type;
+		std::variant<std::vector<int8_t>, std::vector<int16_t>, std::vector<int32_t>, std::vector<int64_t>,
+			std::vector<float>, std::vector<double>, NBT_StringColumn> data;
+		std::vector<uint8_t> validity; //1 if the row has a value, 0 if it is null.
+		size_t nullCount{ 0u };
+
+		NBT_Column(const NBT_ColumnSpec& spec);
+		void appendValue(const byte* payload, size_t available, bool present);
+		void append(const NBT_Column& other);
+		void truncate(size_t rows);
+
+	public:
+		[[nodiscard]]
+		const std::string& getPath() const {
+			return path;
+		}
+		[[nodiscard]]
+		TagID getType() const {
+			return type;
+		}
+		[[nodiscard]]
+		size_t size() const {
+			return validity.size();
+		}
+
+		//T has to match the column type, otherwise std::runtime_error is thrown.
+		template<typename T>
+		[[nodiscard]]
+		std::span<const T> values() const {
+			if (type != numberTagID<T>())
+				throw std::runtime_error("Type mismatch, column " + path + " holds " + TagIDToString(type) + " values.");
+			return std::get<std::vector<T>>(data);
+		}
+		//Throws std::runtime_error if the column does not hold strings.
+		[[nodiscard]]
+		const NBT_StringColumn& strings() const;
+
+		[[nodiscard]]
+		std::span<const uint8_t> getValidity() const {
+			return validity;
+		}
+		[[nodiscard]]
+		bool isNull(size_t row) const {
+			return validity[row] == 0u;
+		}
+		[[nodiscard]]
+		size_t getNullCount() const {
+			return nullCount;
+		}
+	};
+
+	struct NBT_ColumnBatch {
+		std::vector<NBT_Column> columns; //In the order of the specs passed to the extractor.
+		std::vector<size_t> documentIndex; //Index of the document each row was extracted from.
+		std::vector<size_t> failedDocuments; //Malformed documents, which contribute no rows.
+
+		[[nodiscard]]
+		size_t rowCount() const {
+			return documentIndex.size();
+		}
+
+		//Appends the rows of another batch from the same extractor, adding documentOffset to its document indices.
+		//Used to combine the batches of a stream of documents processed in parts.
+		void append(const NBT_ColumnBatch& other, size_t documentOffset = 0u);
+		void truncate(size_t rows);
+	};
+
+	//Extracts fields from many encoded NBT documents into typed columns, working directly on the encoded data without building tag trees.
+	class NBT_ColumnExtractor {
+		std::vector<NBT_ColumnSpec> specs;
+		std::string recordPath;
+		NBT_RawPathSet paths; //Of the specs, resolved with one pass over each record.
+
+		void extractDocument(const std::span<const byte>& document, size_t documentIndex, NBT_ColumnBatch& batch) const;
+
+	public:
+		//Every compound at recordPath becomes a row: each element if it is a list of compounds, otherwise the compound itself.
+		//An empty recordPath makes each document's root compound a row. Throws std::invalid_argument if a column type is not a number type or String,
+		//or if a path is malformed.
+		explicit NBT_ColumnExtractor(std::vector<NBT_ColumnSpec> columns, std::string recordPath = {});
+
+		[[nodiscard]]
+		NBT_ColumnBatch makeEmptyBatch() const;
+
+		//Extracts the rows of uncompressed documents in parallel on up to threadCount threads (0 = hardware concurrency).
+		//Rows are in document order. Malformed documents are listed in failedDocuments instead of throwing.
+		[[nodiscard]]
+		NBT_ColumnBatch extract(std::span<const std::span<const byte>> documents, size_t threadCount = 0u) const;
+	};
+}
@@ -0,0 +1,393 @@
+#include "NBT_LibCompression.h"
+#include <stdexcept>
+#include <string>
+#include <limits>
+#include <algorithm>
+#include <future>
+#include <thread>
+#include <zlib.h>
+
+#include "NBT_Lib.h"
+
+namespace NBT_Lib {
+	int windowBitsForFormat(CompressionFormat format) {
+		switch (format) {
+			using enum CompressionFormat;
+		case Auto:
+			return MAX_WBITS + 32; //zlib detects gzip or zlib headers automatically.
+		case GZip:
+			return MAX_WBITS + 16;
+		case Zlib:
+			return MAX_WBITS;
+		case Raw:
+			return -MAX_WBITS;
+		}
+		return MAX_WBITS + 32;
+	}
+
+	void decompressData(const byte* data, size_t size, std::vector<byte>& out, CompressionFormat format) {
+		if (size > std::numeric_limits<uInt>::max())
+			throw std::runtime_error("Compressed data is too large to be decompressed in one piece.");
+
+		z_stream stream{};
+		if (inflateInit2(&stream, windowBitsForFormat(format)) != Z_OK)
+			throw std::runtime_error("Failed to initialize zlib inflate stream.");
+
+		stream.next_in = reinterpret_cast<Bytef*>(const_cast<byte*>(data));
+		stream.avail_in = static_cast<uInt>(size);
+
+		//NBT usually compresses well, so start at a few times the input size.
+		out.resize(std::max(out.capacity(), std::max<size_t>(size * 4u, 1u << 12u)));
+		size_t written{ 0u };
+		int result{ Z_OK };
+		while (result != Z_STREAM_END) {
+			if (written == out.size())
+				out.resize(out.size() * 2u);
+
+			const size_t available{ std::min<size_t>(out.size() - written, std::numeric_limits<uInt>::max()) };
+			stream.next_out = reinterpret_cast<Bytef*>(out.data() + written);
+			stream.avail_out = static_cast<uInt>(available);
+
+			result = inflate(&stream, Z_NO_FLUSH);
+			written += available - stream.avail_out;
+
+			if (result == Z_BUF_ERROR && stream.avail_in == 0u)
+				result = Z_DATA_ERROR; //Input ended before the end of the stream.
+			if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR) {
+				const std::string message{ stream.msg ? stream.msg : "unknown error" };
+				inflateEnd(&stream);
+				throw std::runtime_error("Failed to decompress data: " + message);
+			}
+		}
+		inflateEnd(&stream);
+		out.resize(written);
+	}
+
+	void compressData(const byte* data, size_t size, std::vector<byte>& out, CompressionFormat format, int level) {
+		if (format == CompressionFormat::Auto)
+			throw std::invalid_argument("A concrete compression format is required for compressing data.");
+		if (size > std::numeric_limits<uInt>::max())
+			throw std::runtime_error("Data is too large to be compressed in one piece.");
+
+		z_stream stream{};
+		if (deflateInit2(&stream, level, Z_DEFLATED, windowBitsForFormat(format), 8, Z_DEFAULT_STRATEGY) != Z_OK)
+			throw std::runtime_error("Failed to initialize zlib deflate stream.");
+
+		//deflateBound is large enough for a single deflate call with Z_FINISH to complete.
+		const size_t offset{ out.size() };
+		out.resize(offset + deflateBound(&stream, static_cast<uLong>(size)));
+
+		stream.next_in = reinterpret_cast<Bytef*>(const_cast<byte*>(data));
+		stream.avail_in = static_cast<uInt>(size);
+		stream.next_out = reinterpret_cast<Bytef*>(out.data() + offset);
+		stream.avail_out = static_cast<uInt>(out.size() - offset);
+
+		const int result{ deflate(&stream, Z_FINISH) };
+		deflateEnd(&stream);
+		if (result != Z_STREAM_END)
+			throw std::runtime_error("Failed to compress data.");
+
+		out.resize(out.size() - stream.avail_out);
+	}
+
+	namespace {
+		//Size of the deflate window, the data a block is primed with.
+		constexpr size_t DICTIONARY_SIZE{ size_t{ 1u } << MAX_WBITS };
+
+		//Runs deflate on all input of stream until it returns with room left in out, or until the stream ends with Z_FINISH.
+		//out is grown as needed, written is the number of bytes of out in use.
+		void deflateToVector(z_stream& stream, int flush, std::vector<byte>& out, size_t& written) {
+			while (true) {
+				if (written == out.size())
+					out.resize(std::max<size_t>(out.size() + out.size() / 2u, written + (1u << 16u)));
+
+				const size_t available{ std::min<size_t>(out.size() - written, std::numeric_limits<uInt>::max()) };
+				stream.next_out = reinterpret_cast<Bytef*>(out.data() + written);
+				stream.avail_out = static_cast<uInt>(available);
+
+				const int result{ deflate(&stream, flush) };
+				written += available - stream.avail_out;
+				if (result == Z_STREAM_ERROR)
+					throw std::runtime_error("Failed to compress data.");
+				if (result == Z_STREAM_END || (flush != Z_FINISH && stream.avail_out != 0u))
+					return;
+			}
+		}
+
+		template<typename valueType>
+		void appendBigEndian(std::vector<byte>& out, valueType value) {
+			for (size_t i = sizeof(valueType); i-- > 0u;)
+				out.push_back(static_cast<byte>(value >> (i * 8u)));
+		}
+		template<typename valueType>
+		void appendLittleEndian(std::vector<byte>& out, valueType value) {
+			for (size_t i = 0u; i < sizeof(valueType); ++i)
+				out.push_back(static_cast<byte>(value >> (i * 8u)));
+		}
+	}
+
+	struct CompressionStream::State {
+		struct Block {
+			std::vector<byte> input;
+			std::vector<byte> dictionary; //The data before the block.
+			std::vector<byte> output;
+			uLong check{ 0u }; //crc32 or adler32 of input, depending on the format.
+		};
+
+		std::vector<byte>& out;
+		CompressionOptions options;
+		size_t threadCount;
+		uint64_t bytesIn{ 0u };
+		bool finished{ false };
+
+		//Single threaded, out is written directly and is resized ahead of the data.
+		z_stream stream{};
+		bool streamInitialized{ false };
+		size_t written{ 0u };
+
+		//Multi threaded.
+		std::vector<byte> current; //Block being filled.
+		std::vector<byte> lastTail; //The last DICTIONARY_SIZE bytes of the previous block.
+		std::vector<Block> filling; //Full blocks for the next batch.
+		std::vector<Block> compressing;
+		std::vector<std::vector<byte>> spareBuffers;
+		uLong check{ 0u };
+		std::future<void> inFlight; //Compresses the blocks in compressing, declared after them so it is waited for before they are destroyed.
+
+		State(std::vector<byte>& out, const CompressionOptions& options)
+			: out{ out }, options{ options }
+			, threadCount{ options.threadCount != 0u ? options.threadCount : std::max(1u, std::thread::hardware_concurrency()) } {
+
+			if (options.format == CompressionFormat::Auto)
+				throw std::invalid_argument("A concrete compression format is required for compressing data.");
+
+			written = out.size();
+			if (threadCount <= 1u) {
+				if (deflateInit2(&stream, options.level, Z_DEFLATED, windowBitsForFormat(options.format), 8, Z_DEFAULT_STRATEGY) != Z_OK)
+					throw std::runtime_error("Failed to initialize zlib deflate stream.");
+				streamInitialized = true;
+				return;
+			}
+
+			this->options.blockSize = std::clamp<size_t>(options.blockSize, 1u << 16u, 1u << 30u);
+			current.reserve(this->options.blockSize);
+			writeHeader();
+		}
+
+		~State() {
+			if (inFlight.valid())
+				inFlight.wait();
+			if (streamInitialized)
+				deflateEnd(&stream);
+			if (!finished) //After finish out belongs to the caller again, who may have appended to it.
+				out.resize(written);
+		}
+
+		void writeHeader() {
+			const int level{ options.level < 0 ? Z_DEFAULT_COMPRESSION : options.level };
+			if (options.format == CompressionFormat::Zlib) {
+				//CMF: deflate with a 32 KiB window, FLG: the level class as zlib writes it and the check bits.
+				const unsigned cmf{ 0x78u };
+				const unsigned levelClass{ level == Z_DEFAULT_COMPRESSION || level == 6 ? 2u : level < 2 ? 0u : level < 6 ? 1u : 3u };
+				unsigned flg{ levelClass << 6u };
+				flg += 31u - ((cmf << 8u) | flg) % 31u;
+				out.push_back(static_cast<byte>(cmf));
+				out.push_back(static_cast<byte>(flg));
+				check = adler32(0u, Z_NULL, 0u);
+			}
+			else if (options.format == CompressionFormat::GZip) {
+				const byte extraFlags{ level == 9 ? byte{ 2u } : level == 1 ? byte{ 4u } : byte{ 0u } };
+				out.insert(out.end(), { byte{ 0x1fu }, byte{ 0x8bu }, byte{ 8u }, byte{ 0u }, byte{ 0u }, byte{ 0u }, byte{ 0u }, byte{ 0u }, extraFlags, byte{ 0xffu } });
+				check = crc32(0u, Z_NULL, 0u);
+			}
+			written = out.size();
+		}
+
+		void writeTrailer() {
+			if (options.format == CompressionFormat::Zlib) {
+				appendBigEndian(out, static_cast<uint32_t>(check));
+			}
+			else if (options.format == CompressionFormat::GZip) {
+				appendLittleEndian(out, static_cast<uint32_t>(check));
+				appendLittleEndian(out, static_cast<uint32_t>(bytesIn));
+			}
+			written = out.size();
+		}
+
+		void compressBlock(Block& block, bool last) const {
+			z_stream blockStream{};
+			if (deflateInit2(&blockStream, options.level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+				throw std::runtime_error("Failed to initialize zlib deflate stream.");
+			try {
+				if (!block.dictionary.empty())
+					deflateSetDictionary(&blockStream, reinterpret_cast<const Bytef*>(block.dictionary.data()), static_cast<uInt>(block.dictionary.size()));
+
+				//A block that is not the last ends with a sync flush, which ends it on a byte boundary without marking the end of the stream.
+				block.output.resize(deflateBound(&blockStream, static_cast<uLong>(block.input.size())) + 16u);
+				size_t blockWritten{ 0u };
+				blockStream.next_in = reinterpret_cast<Bytef*>(block.input.data());
+				blockStream.avail_in = static_cast<uInt>(block.input.size());
+				deflateToVector(blockStream, last ? Z_FINISH : Z_SYNC_FLUSH, block.output, blockWritten);
+				block.output.resize(blockWritten);
+			}
+			catch (...) {
+				deflateEnd(&blockStream);
+				throw;
+			}
+			deflateEnd(&blockStream);
+
+			if (options.format == CompressionFormat::Zlib)
+				block.check = adler32(1u, reinterpret_cast<const Bytef*>(block.input.data()), static_cast<uInt>(block.input.size()));
+			else if (options.format == CompressionFormat::GZip)
+				block.check = crc32(0u, reinterpret_cast<const Bytef*>(block.input.data()), static_cast<uInt>(block.input.size()));
+		}
+
+		void compressBlocks(std::vector<Block>& blocks, bool lastIsFinal) const {
+			parallelFor(blocks.size(), threadCount, [&](size_t i, size_t) {
+				compressBlock(blocks[i], lastIsFinal && i + 1u == blocks.size());
+			});
+		}
+
+		//Appends compressed blocks to out in order and returns their buffers for reuse.
+		void appendBlocks(std::vector<Block>& blocks) {
+			for (Block& block : blocks) {
+				out.insert(out.end(), block.output.begin(), block.output.end());
+				const z_off_t length{ static_cast<z_off_t>(block.input.size()) };
+				if (options.format == CompressionFormat::Zlib)
+					check = adler32_combine(check, block.check, length);
+				else if (options.format == CompressionFormat::GZip)
+					check = crc32_combine(check, block.check, length);
+
+				block.input.clear();
+				spareBuffers.push_back(std::move(block.input));
+			}
+			blocks.clear();
+			written = out.size();
+		}
+
+		//Waits for the batch in the background and appends it.
+		void collect() {
+			if (!inFlight.valid())
+				return;
+			inFlight.get();
+			appendBlocks(compressing);
+		}
+
+		void completeBlock() {
+			Block block;
+			block.input = std::move(current);
+			block.dictionary = lastTail;
+			const size_t tailSize{ std::min(block.input.size(), DICTIONARY_SIZE) };
+			lastTail.assign(block.input.end() - tailSize, block.input.end());
+			filling.push_back(std::move(block));
+
+			if (!spareBuffers.empty()) {
+				current = std::move(spareBuffers.back());
+				spareBuffers.pop_back();
+			}
+			else {
+				current = {};
+				current.reserve(options.blockSize);
+			}
+
+			//Two blocks per thread keep the threads busy while the blocks of a batch take different times.
+			if (filling.size() >= threadCount * 2u) {
+				collect();
+				compressing.swap(filling);
+				inFlight = std::async(std::launch::async, [this]() {
+					compressBlocks(compressing, false);
+				});
+			}
+		}
+
+		void write(const byte* data, size_t size) {
+			if (finished)
+				throw std::runtime_error("Data written to a finished CompressionStream.");
+			bytesIn += size;
+
+			if (streamInitialized) {
+				while (size != 0u) {
+					const size_t part{ std::min<size_t>(size, 1u << 30u) };
+					stream.next_in = reinterpret_cast<Bytef*>(const_cast<byte*>(data));
+					stream.avail_in = static_cast<uInt>(part);
+					deflateToVector(stream, Z_NO_FLUSH, out, written);
+					data += part;
+					size -= part;
+				}
+				return;
+			}
+
+			while (size != 0u) {
+				const size_t part{ std::min(size, options.blockSize - current.size()) };
+				current.insert(current.end(), data, data + part);
+				data += part;
+				size -= part;
+				if (current.size() == options.blockSize)
+					completeBlock();
+			}
+		}
+
+		void finish() {
+			if (finished)
+				return;
+			finished = true;
+
+			if (streamInitialized) {
+				stream.next_in = nullptr;
+				stream.avail_in = 0u;
+				deflateToVector(stream, Z_FINISH, out, written);
+				out.resize(written);
+				return;
+			}
+
+			//The last block is compressed even when it is empty, it marks the end of the deflate stream.
+			collect();
+			Block block;
+			block.input = std::move(current);
+			block.dictionary = std::move(lastTail);
+			filling.push_back(std::move(block));
+			compressBlocks(filling, true);
+			appendBlocks(filling);
+			writeTrailer();
+		}
+	};
+
+	CompressionStream::CompressionStream(std::vector<byte>& out, const CompressionOptions& options)
+		: state{ std::make_unique<State>(out, options) } {
+	}
+
+	CompressionStream::~CompressionStream() = default;
+
+	void CompressionStream::write(const void* data, size_t size) {
+		state->write(static_cast<const byte*>(data), size);
+	}
+
+	void CompressionStream::finish() {
+		state->finish();
+	}
+
+	uint64_t CompressionStream::getBytesIn() const {
+		return state->bytesIn;
+	}
+
+	void buildCompressedNBTFile(const Compound_Tag* root, std::vector<byte>& out, const CompressionOptions& options) {
+		CompressionStream compressor(out, options);
+		BinaryStream bstream([&](const byte* data, size_t size) {
+			compressor.write(data, size);
+		});
+		root->addTagHeaderToBinaryStream(bstream);
+		root->addTagToBinaryStream(bstream);
+		bstream.flush();
+		compressor.finish();
+	}
+
+	bool isCompressed(const byte* data, size_t size) {
+		if (size < 2u)
+			return false;
+		if (data[0] == byte{ 0x1f } && data[1] == byte{ 0x8b }) //gzip magic.
+			return true;
+		const unsigned cmf{ std::to_integer<unsigned>(data[0]) };
+		const unsigned flg{ std::to_integer<unsigned>(data[1]) };
+		return (cmf & 0x0fu) == 8u && ((cmf << 8u) | flg) % 31u == 0u; //zlib header with deflate method.
+	}
+}
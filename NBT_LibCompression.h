@@ -0,0 +1,90 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+//Optional zlib based helpers, the core library (NBT_Lib.h) does not depend on these.
+//Requires linking against zlib.
+
+namespace NBT_Lib {
+	using std::byte;
+	struct Compound_Tag;
+
+	enum class CompressionFormat {
+		Auto,	//Detect gzip or zlib framing from the header (decompression only).
+		GZip,
+		Zlib,
+		Raw		//Raw deflate stream without any framing.
+	};
+
+	//Decompresses data into out, replacing its contents. The capacity of out is reused, so a buffer kept
+	//around between calls will stop allocating once it has grown to the largest decompressed size.
+	void decompressData(const byte* data, size_t size, std::vector<byte>& out, CompressionFormat format = CompressionFormat::Auto);
+
+	[[nodiscard]]
+	inline std::vector<byte> decompressData(const byte* data, size_t size, CompressionFormat format = CompressionFormat::Auto) {
+		std::vector<byte> out;
+		decompressData(data, size, out, format);
+		return out;
+	}
+
+	//Compression level passed to zlib, from 0 (none) to 9 (best), -1 selects zlib's default.
+	constexpr int DEFAULT_COMPRESSION_LEVEL{ -1 };
+
+	//Compresses data and appends the result to out, so a header can be placed in front of it without copying.
+	void compressData(const byte* data, size_t size, std::vector<byte>& out, CompressionFormat format = CompressionFormat::Zlib, int level = DEFAULT_COMPRESSION_LEVEL);
+
+	[[nodiscard]]
+	inline std::vector<byte> compressData(const byte* data, size_t size, CompressionFormat format = CompressionFormat::Zlib, int level = DEFAULT_COMPRESSION_LEVEL) {
+		std::vector<byte> out;
+		compressData(data, size, out, format, level);
+		return out;
+	}
+
+	struct CompressionOptions {
+		CompressionFormat format{ CompressionFormat::Zlib };
+		int level{ DEFAULT_COMPRESSION_LEVEL };
+		size_t threadCount{ 1u }; //0 = hardware concurrency.
+		size_t blockSize{ 1u << 17u }; //Uncompressed bytes per block when compressing with multiple threads, at least 64 KiB.
+	};
+
+	//Compresses data written to it piece by piece, e.g. as the sink of an NBT_Writer or a streaming BinaryStream, so the
+	//uncompressed data is compressed while it is produced and never held whole. The result is appended to out.
+	//With a single thread the data goes through one deflate stream. With more, it is split into blocks that are compressed in parallel
+	//like pigz does: every block is primed with the 32 KiB of data before it, so the ratio stays close to that of a single stream,
+	//and the blocks are joined into one standard stream. Blocks are compressed in the background while the following ones are written.
+	class CompressionStream {
+		struct State;
+		std::unique_ptr<State> state;
+
+	public:
+		explicit CompressionStream(std::vector<byte>& out, const CompressionOptions& options = {});
+		CompressionStream(const CompressionStream&) = delete;
+		CompressionStream& operator=(const CompressionStream&) = delete;
+		//Trims out to the data compressed so far if finish was not called, the stream is incomplete then. After finish out is left untouched.
+		~CompressionStream();
+
+		void write(const void* data, size_t size);
+		//Compresses the remaining data and completes the stream, nothing can be written afterwards.
+		void finish();
+
+		//Uncompressed bytes written so far.
+		[[nodiscard]]
+		uint64_t getBytesIn() const;
+	};
+
+	//Encodes a document and compresses it while it is being encoded, appending the result to out.
+	void buildCompressedNBTFile(const Compound_Tag* root, std::vector<byte>& out, const CompressionOptions& options = {});
+
+	[[nodiscard]]
+	inline std::vector<byte> buildCompressedNBTFile(const Compound_Tag* root, const CompressionOptions& options = {}) {
+		std::vector<byte> out;
+		buildCompressedNBTFile(root, out, options);
+		return out;
+	}
+
+	//Returns true if the data starts with a gzip or zlib header.
+	[[nodiscard]]
+	bool isCompressed(const byte* data, size_t size);
+}
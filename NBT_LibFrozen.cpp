@@ -0,0 +1,307 @@
+#include "NBT_LibFrozen.h"
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <new>
+#include <cstring>
+
+
+namespace NBT_Lib {
+	namespace {
+		//Compounds with fewer entries are searched linearly, which is as fast as hashing the name.
+		constexpr size_t PERFECT_HASH_MIN_ENTRIES{ 8u };
+		constexpr size_t PERFECT_HASH_BUCKET_SIZE{ 4u }; //Average number of names per bucket.
+		constexpr uint32_t PERFECT_HASH_MAX_DISPLACEMENT{ 1u << 16u };
+
+		constexpr uint64_t mix64(uint64_t x) {
+			x = (x ^ (x >> 30u)) * 0xbf58476d1ce4e5b9ull;
+			x = (x ^ (x >> 27u)) * 0x94d049bb133111ebull;
+			return x ^ (x >> 31u);
+		}
+
+		//Names are short, so a simple word at a time hash is cheaper than hashBytes, whose setup dominates for a few bytes.
+		uint64_t nameHash(std::string_view name) {
+			const char* ptr{ name.data() };
+			size_t size{ name.size() };
+			uint64_t hash{ size * 0x9e3779b97f4a7c15ull };
+			while (size >= sizeof(uint64_t)) {
+				uint64_t word;
+				memcpy(&word, ptr, sizeof(word));
+				hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+				hash ^= hash >> 32u;
+				ptr += sizeof(word);
+				size -= sizeof(word);
+			}
+			uint64_t tail{ 0u };
+			for (size_t i = 0u; i < size; ++i) //A variable sized memcpy would be a library call.
+				tail |= uint64_t(static_cast<uint8_t>(ptr[i])) << (i * 8u);
+			return mix64(hash ^ tail);
+		}
+
+		//Maps 32 hash bits onto [0, count) with a multiplication instead of a division.
+		constexpr uint32_t reduce(uint64_t hashBits, uint32_t count) {
+			return static_cast<uint32_t>(((hashBits & 0xffffffffu) * count) >> 32u);
+		}
+
+		constexpr uint32_t perfectHashBucket(uint64_t hash, uint32_t bucketCount) {
+			return reduce(hash, bucketCount);
+		}
+
+		//Slot of a name within its compound's table for a given bucket displacement.
+		constexpr uint32_t perfectHashSlot(uint64_t hash, uint32_t displacement, uint32_t slotCount) {
+			return reduce(mix64(hash + (displacement + 1ull) * 0x9e3779b97f4a7c15ull) >> 32u, slotCount);
+		}
+
+		constexpr size_t alignTo8(size_t size) {
+			return (size + 7u) & ~size_t{ 7u };
+		}
+	}
+
+	//Copies the tree breadth first: every node processed appends its children, so the nodes vector doubles as the queue.
+	class FrozenNBT::Builder {
+		std::vector<Node> nodes;
+		std::vector<const NBT_TagBase*> sources; //Tag each node was created from.
+		std::vector<uint32_t> lookupWords;
+		std::vector<byte> arrayData;
+		std::string stringTable;
+		std::unordered_map<std::string_view, uint32_t> stringOffsets; //Views into the source tree, which outlives the builder.
+
+		uint32_t addString(std::string_view str) {
+			const auto [it, inserted] { stringOffsets.try_emplace(str, static_cast<uint32_t>(stringTable.size())) };
+			if (inserted) {
+				if (stringTable.size() + str.size() > UINT32_MAX)
+					throw std::length_error("NBT tree is too large to be frozen.");
+				stringTable.append(str);
+			}
+			return it->second;
+		}
+
+		void addNode(const NBT_TagBase* tag) {
+			if (nodes.size() == UINT32_MAX)
+				throw std::length_error("NBT tree is too large to be frozen.");
+			if (tag->name.size() > UINT16_MAX)
+				throw std::length_error("Name of " + TagIDToString(tag->id) + " is too long to be frozen.");
+			nodes.push_back({ addString(tag->name), static_cast<uint16_t>(tag->name.size()), static_cast<uint8_t>(tag->id), static_cast<uint8_t>(TagID::End), 0u, NO_LOOKUP, 0u });
+			sources.push_back(tag);
+		}
+
+		template<typename valueType>
+		void setNumber(Node& node, const NBT_TagBase* tag) {
+			const valueType value{ static_cast<const NumberType_Tag<valueType, numberTagID<valueType>()>*>(tag)->value };
+			memcpy(&node.value, &value, sizeof(value));
+		}
+
+		template<typename valueType>
+		void setArray(Node& node, const std::pmr::vector<valueType>& values) {
+			if (values.size() > UINT32_MAX)
+				throw std::length_error("NBT array is too large to be frozen.");
+			const size_t offset{ alignTo8(arrayData.size()) };
+			arrayData.resize(offset + values.size() * sizeof(valueType));
+			if (!values.empty())
+				memcpy(arrayData.data() + offset, values.data(), values.size() * sizeof(valueType));
+			node.elementType = static_cast<uint8_t>(numberTagID<valueType>());
+			node.count = static_cast<uint32_t>(values.size());
+			node.value = offset;
+		}
+
+		template<typename Children>
+		void addChildren(size_t nodeIndex, const Children& children) {
+			if (children.size() > UINT32_MAX)
+				throw std::length_error("NBT list or compound is too large to be frozen.");
+			nodes[nodeIndex].value = nodes.size();
+			nodes[nodeIndex].count = static_cast<uint32_t>(children.size());
+			for (const NBT_TagBase* child : children)
+				addNode(child);
+		}
+
+		//Builds a minimal perfect hash table over the entry names of a compound using hash and displace:
+		//names are grouped into buckets, and each bucket, largest first, gets the first displacement that moves
+		//all its names into free slots. Returns NO_LOOKUP if no table could be built.
+		uint32_t buildLookup(uint32_t firstChild, uint32_t count) {
+			struct Key {
+				uint64_t hash;
+				uint32_t nodeIndex;
+			};
+			//Entries with the same name resolve to the last one.
+			std::unordered_map<std::string_view, uint32_t> lastEntry;
+			for (uint32_t i = 0u; i < count; ++i)
+				lastEntry[std::string_view{ sources[firstChild + i]->name }] = firstChild + i;
+
+			std::vector<Key> keys;
+			keys.reserve(lastEntry.size());
+			for (const auto& [name, nodeIndex] : lastEntry)
+				keys.push_back({ nameHash(name), nodeIndex });
+
+			const uint32_t slotCount{ static_cast<uint32_t>(keys.size()) };
+			const uint32_t bucketCount{ static_cast<uint32_t>((slotCount + PERFECT_HASH_BUCKET_SIZE - 1u) / PERFECT_HASH_BUCKET_SIZE) };
+			std::vector<std::vector<uint32_t>> buckets(bucketCount);
+			for (uint32_t i = 0u; i < keys.size(); ++i)
+				buckets[perfectHashBucket(keys[i].hash, bucketCount)].push_back(i);
+
+			std::vector<uint32_t> bucketOrder(bucketCount);
+			for (uint32_t i = 0u; i < bucketCount; ++i)
+				bucketOrder[i] = i;
+			std::stable_sort(bucketOrder.begin(), bucketOrder.end(), [&](uint32_t a, uint32_t b) { return buckets[a].size() > buckets[b].size(); });
+
+			const size_t offset{ lookupWords.size() };
+			lookupWords.resize(offset + 2u + bucketCount + slotCount, UINT32_MAX);
+			uint32_t* table{ lookupWords.data() + offset };
+			table[0] = bucketCount;
+			table[1] = slotCount;
+			uint32_t* displacements{ table + 2u };
+			uint32_t* slots{ displacements + bucketCount };
+
+			std::vector<uint32_t> bucketSlots;
+			for (const uint32_t bucket : bucketOrder) {
+				if (buckets[bucket].empty())
+					break;
+				bool placed{ false };
+				for (uint32_t displacement = 0u; displacement < PERFECT_HASH_MAX_DISPLACEMENT && !placed; ++displacement) {
+					bucketSlots.clear();
+					placed = true;
+					for (const uint32_t key : buckets[bucket]) {
+						const uint32_t slot{ perfectHashSlot(keys[key].hash, displacement, slotCount) };
+						if (slots[slot] != UINT32_MAX || std::find(bucketSlots.begin(), bucketSlots.end(), slot) != bucketSlots.end()) {
+							placed = false;
+							break;
+						}
+						bucketSlots.push_back(slot);
+					}
+					if (placed) {
+						displacements[bucket] = displacement;
+						for (size_t i = 0u; i < bucketSlots.size(); ++i)
+							slots[bucketSlots[i]] = keys[buckets[bucket][i]].nodeIndex;
+					}
+				}
+				if (!placed) {
+					lookupWords.resize(offset);
+					return NO_LOOKUP;
+				}
+			}
+			if (offset > UINT32_MAX)
+				throw std::length_error("NBT tree is too large to be frozen.");
+			return static_cast<uint32_t>(offset);
+		}
+
+		void fillNode(size_t nodeIndex) {
+			const NBT_TagBase* tag{ sources[nodeIndex] };
+			switch (tag->id) {
+				using enum TagID;
+			case Byte:
+				setNumber<int8_t>(nodes[nodeIndex], tag);
+				break;
+			case Short:
+				setNumber<int16_t>(nodes[nodeIndex], tag);
+				break;
+			case Int:
+				setNumber<int32_t>(nodes[nodeIndex], tag);
+				break;
+			case Long:
+				setNumber<int64_t>(nodes[nodeIndex], tag);
+				break;
+			case Float:
+				setNumber<float>(nodes[nodeIndex], tag);
+				break;
+			case Double:
+				setNumber<double>(nodes[nodeIndex], tag);
+				break;
+			case Byte_Array:
+				setArray(nodes[nodeIndex], static_cast<const ByteArray_Tag*>(tag)->values);
+				break;
+			case Int_Array:
+				setArray(nodes[nodeIndex], static_cast<const IntArray_Tag*>(tag)->values);
+				break;
+			case Long_Array:
+				setArray(nodes[nodeIndex], static_cast<const LongArray_Tag*>(tag)->values);
+				break;
+			case String: {
+				const auto& value{ static_cast<const String_Tag*>(tag)->value };
+				nodes[nodeIndex].value = addString(value);
+				nodes[nodeIndex].count = static_cast<uint32_t>(value.size());
+				break;
+			}
+			case List: {
+				const List_Tag* list{ static_cast<const List_Tag*>(tag) };
+				nodes[nodeIndex].elementType = static_cast<uint8_t>(list->listType);
+				addChildren(nodeIndex, list->values);
+				break;
+			}
+			case Compound: {
+				const Compound_Tag* compound{ static_cast<const Compound_Tag*>(tag) };
+				addChildren(nodeIndex, compound->values);
+				if (compound->values.size() >= PERFECT_HASH_MIN_ENTRIES)
+					nodes[nodeIndex].lookup = buildLookup(static_cast<uint32_t>(nodes[nodeIndex].value), nodes[nodeIndex].count);
+				break;
+			}
+			default:
+				throw std::runtime_error("Invalid tag id encountered while freezing NBT tree.");
+			}
+		}
+
+	public:
+		FrozenNBT build(const Compound_Tag& root) {
+			addNode(&root);
+			for (size_t i = 0u; i < nodes.size(); ++i)
+				fillNode(i);
+
+			//Everything goes into one block: section pointers, nodes, lookup tables, array values and the string table.
+			const size_t nodesOffset{ alignTo8(sizeof(Sections)) };
+			const size_t nodesSize{ nodes.size() * sizeof(Node) };
+			const size_t lookupOffset{ alignTo8(nodesOffset + nodesSize) };
+			const size_t dataOffset{ alignTo8(lookupOffset + lookupWords.size() * sizeof(uint32_t)) };
+			const size_t stringsOffset{ dataOffset + arrayData.size() };
+
+			FrozenNBT frozen;
+			frozen.blockSize = stringsOffset + stringTable.size();
+			frozen.block = std::make_unique_for_overwrite<byte[]>(frozen.blockSize);
+			byte* block{ frozen.block.get() };
+			memcpy(block + nodesOffset, nodes.data(), nodesSize);
+			if (!lookupWords.empty())
+				memcpy(block + lookupOffset, lookupWords.data(), lookupWords.size() * sizeof(uint32_t));
+			if (!arrayData.empty())
+				memcpy(block + dataOffset, arrayData.data(), arrayData.size());
+			if (!stringTable.empty())
+				memcpy(block + stringsOffset, stringTable.data(), stringTable.size());
+
+			new (block) Sections{
+				reinterpret_cast<const Node*>(block + nodesOffset),
+				reinterpret_cast<const uint32_t*>(block + lookupOffset),
+				block + dataOffset,
+				reinterpret_cast<const char*>(block + stringsOffset)
+			};
+			return frozen;
+		}
+	};
+
+	FrozenTag FrozenNBT::Sections::findEntry(const Node& compound, std::string_view name) const {
+		const auto matches{ [&](uint32_t nodeIndex) {
+			const Node& entry{ nodes[nodeIndex] };
+			return entry.nameLength == name.size() && memcmp(strings + entry.nameOffset, name.data(), name.size()) == 0;
+		} };
+
+		if (compound.lookup == NO_LOOKUP) {
+			//Searched backwards, so duplicate names resolve to the last entry.
+			for (uint32_t i = compound.count; i > 0u; --i) {
+				const uint32_t nodeIndex{ static_cast<uint32_t>(compound.value + i - 1u) };
+				if (matches(nodeIndex))
+					return { this, nodeIndex };
+			}
+			return {};
+		}
+
+		const uint32_t* table{ lookupWords + compound.lookup };
+		const uint32_t bucketCount{ table[0] };
+		const uint32_t slotCount{ table[1] };
+		const uint64_t hash{ nameHash(name) };
+		const uint32_t displacement{ table[2u + perfectHashBucket(hash, bucketCount)] };
+		const uint32_t nodeIndex{ table[2u + bucketCount + perfectHashSlot(hash, displacement, slotCount)] };
+		if (matches(nodeIndex))
+			return { this, nodeIndex };
+		return {};
+	}
+
+	FrozenNBT freeze(const Compound_Tag& root) {
+		return FrozenNBT::Builder{}.build(root);
+	}
+}
@@ -0,0 +1,189 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <stdexcept>
+
+#include "NBT_Lib.h"
+
+namespace NBT_Lib {
+	class FrozenTag;
+
+	//Immutable copy of an NBT tree in a single block of memory, created by freeze.
+	//Nodes are laid out breadth first, so the entries of a compound or list are adjacent, and all names and
+	//strings are stored once in a shared string table. Compounds with many entries get a minimal perfect hash
+	//table, making find a constant time lookup touching only a few cache lines.
+	//Nothing is modified after construction, so a FrozenNBT can be read from any number of threads without synchronization.
+	//Views into it stay valid when it is moved.
+	class FrozenNBT {
+		friend class FrozenTag;
+		friend FrozenNBT freeze(const Compound_Tag& root);
+
+		struct Node {
+			uint32_t nameOffset; //Into the string table.
+			uint16_t nameLength;
+			uint8_t type; //TagID
+			uint8_t elementType; //TagID
+			uint32_t count; //Children of lists and compounds, values of arrays, bytes of strings.
+			uint32_t lookup; //Compounds: word offset of the perfect hash table, NO_LOOKUP if the entries are searched linearly.
+			uint64_t value; //Numbers: the value's bits. Lists and compounds: index of the first child node. Strings and arrays: byte offset of the data.
+
+			TagID getType() const {
+				return static_cast<TagID>(type);
+			}
+			TagID getElementType() const {
+				return static_cast<TagID>(elementType);
+			}
+		};
+		static constexpr uint32_t NO_LOOKUP{ UINT32_MAX };
+		class Builder;
+
+		//Stored at the start of the block, so views stay valid when the FrozenNBT is moved.
+		struct Sections {
+			const Node* nodes;
+			const uint32_t* lookupWords;
+			const byte* data; //Array values, 8 byte aligned.
+			const char* strings;
+
+			const Node& node(uint32_t index) const {
+				return nodes[index];
+			}
+			FrozenTag findEntry(const Node& compound, std::string_view name) const;
+		};
+
+		std::unique_ptr<byte[]> block;
+		size_t blockSize{ 0u };
+
+	public:
+		FrozenNBT() = default;
+
+		//Empty view if the FrozenNBT was default constructed.
+		[[nodiscard]]
+		FrozenTag getRoot() const;
+		//Size of the memory block holding the tree.
+		[[nodiscard]]
+		size_t getMemoryUsage() const {
+			return blockSize;
+		}
+	};
+
+	//Read only view of a tag inside a FrozenNBT, cheap to copy and valid as long as the FrozenNBT it belongs to exists.
+	//An empty view (operator bool returns false) is returned by lookups that found nothing.
+	class FrozenTag {
+		friend class FrozenNBT;
+
+		const FrozenNBT::Sections* frozen{ nullptr };
+		uint32_t nodeIndex{ 0u };
+
+		FrozenTag(const FrozenNBT::Sections* frozen, uint32_t nodeIndex)
+			: frozen{ frozen }, nodeIndex{ nodeIndex } {
+		}
+
+	public:
+		FrozenTag() = default;
+
+		explicit operator bool() const {
+			return frozen != nullptr;
+		}
+
+		[[nodiscard]]
+		TagID getType() const;
+		[[nodiscard]]
+		std::string_view getName() const;
+
+		//Number of entries of a compound, elements of a list or values of an array, 1 for other tags.
+		[[nodiscard]]
+		size_t size() const;
+		//Element type of a list or array.
+		[[nodiscard]]
+		TagID getElementType() const;
+
+		//Entry of a compound or element of a list, throws std::out_of_range if index is not below size().
+		[[nodiscard]]
+		FrozenTag operator[](size_t index) const;
+		//Entry of a compound with the given name, an empty view if there is none or this is not a compound.
+		[[nodiscard]]
+		FrozenTag find(std::string_view name) const;
+
+		//The following throw std::runtime_error if the tag has a different type.
+		template<typename T>
+		[[nodiscard]]
+		T getValue() const;
+		[[nodiscard]]
+		std::string_view getString() const;
+		//Values of a Byte/Int/Long array, T has to be int8_t, int32_t or int64_t respectively.
+		template<typename T>
+		[[nodiscard]]
+		std::span<const T> getArray() const;
+	};
+
+	//Creates an immutable copy of the tree below root, see FrozenNBT.
+	//If a compound contains several entries with the same name, find returns the last one, like Compound_Tag::indexMap.
+	//Throws std::length_error if a name is longer than 65535 bytes, which NBT can not encode either, or the tree is too large.
+	[[nodiscard]]
+	FrozenNBT freeze(const Compound_Tag& root);
+
+	inline FrozenTag FrozenNBT::getRoot() const {
+		return block ? FrozenTag{ reinterpret_cast<const Sections*>(block.get()), 0u } : FrozenTag{};
+	}
+
+	inline TagID FrozenTag::getType() const {
+		return frozen->node(nodeIndex).getType();
+	}
+
+	inline std::string_view FrozenTag::getName() const {
+		const FrozenNBT::Node& node{ frozen->node(nodeIndex) };
+		return { frozen->strings + node.nameOffset, node.nameLength };
+	}
+
+	inline size_t FrozenTag::size() const {
+		const FrozenNBT::Node& node{ frozen->node(nodeIndex) };
+		return node.getType() == TagID::String ? 1u : node.count;
+	}
+
+	inline TagID FrozenTag::getElementType() const {
+		return frozen->node(nodeIndex).getElementType();
+	}
+
+	inline FrozenTag FrozenTag::operator[](size_t index) const {
+		const FrozenNBT::Node& node{ frozen->node(nodeIndex) };
+		if ((node.getType() != TagID::List && node.getType() != TagID::Compound) || index >= node.count)
+			throw std::out_of_range("Index " + std::to_string(index) + " is out of range of the frozen " + TagIDToString(node.getType()) + '.');
+		return { frozen, static_cast<uint32_t>(node.value + index) };
+	}
+
+	inline FrozenTag FrozenTag::find(std::string_view name) const {
+		const FrozenNBT::Node& node{ frozen->node(nodeIndex) };
+		if (node.getType() != TagID::Compound)
+			return {};
+		return frozen->findEntry(node, name);
+	}
+
+	template<typename T>
+	inline T FrozenTag::getValue() const {
+		const FrozenNBT::Node& node{ frozen->node(nodeIndex) };
+		if (node.getType() != numberTagID<T>())
+			throw std::runtime_error("Type mismatch, cannot read a frozen " + TagIDToString(node.getType()) + " as " + TagIDToString(numberTagID<T>()) + '.');
+		T value;
+		memcpy(&value, &node.value, sizeof(value));
+		return value;
+	}
+
+	inline std::string_view FrozenTag::getString() const {
+		const FrozenNBT::Node& node{ frozen->node(nodeIndex) };
+		if (node.getType() != TagID::String)
+			throw std::runtime_error("Type mismatch, cannot read a frozen " + TagIDToString(node.getType()) + " as String.");
+		return { frozen->strings + node.value, node.count };
+	}
+
+	template<typename T>
+	inline std::span<const T> FrozenTag::getArray() const {
+		const FrozenNBT::Node& node{ frozen->node(nodeIndex) };
+		if ((node.getType() != TagID::Byte_Array && node.getType() != TagID::Int_Array && node.getType() != TagID::Long_Array) || node.getElementType() != numberTagID<T>())
+			throw std::runtime_error("Type mismatch, cannot read a frozen " + TagIDToString(node.getType()) + " as an array of " + TagIDToString(numberTagID<T>()) + '.');
+		return { reinterpret_cast<const T*>(frozen->data + node.value), node.count };
+	}
+}
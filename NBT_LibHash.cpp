@@ -0,0 +1,561 @@
+#include "NBT_LibHash.h"
+#include <array>
+#include <cstring>
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+namespace NBT_Lib {
+	namespace {
+		constexpr uint64_t P0{ 0xa0761d6478bd642full };
+		constexpr uint64_t P1{ 0xe7037ed1a0b428dbull };
+		constexpr uint64_t P2{ 0x8ebc6af09c88c6e3ull };
+		constexpr uint64_t P3{ 0x589965cc75374cc3ull };
+
+		//Deeper documents are rejected by hashRawNBT instead of risking a stack overflow.
+		constexpr size_t MAX_RAW_HASH_DEPTH{ 512u };
+
+		//64x64 -> 128 bit multiplication folded back to 64 bits.
+		inline uint64_t mum(uint64_t a, uint64_t b) {
+#if defined(_MSC_VER) && defined(_M_X64)
+			uint64_t high;
+			const uint64_t low{ _umul128(a, b, &high) };
+			return low ^ high;
+#elif defined(__SIZEOF_INT128__)
+			const unsigned __int128 product{ static_cast<unsigned __int128>(a) * b };
+			return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64u);
+#else
+			const uint64_t aLow{ a & 0xffffffffu }, aHigh{ a >> 32u }, bLow{ b & 0xffffffffu }, bHigh{ b >> 32u };
+			const uint64_t lowLow{ aLow * bLow }, lowHigh{ aLow * bHigh }, highLow{ aHigh * bLow }, highHigh{ aHigh * bHigh };
+			const uint64_t middle{ (lowLow >> 32u) + (lowHigh & 0xffffffffu) + (highLow & 0xffffffffu) };
+			const uint64_t low{ (lowLow & 0xffffffffu) | (middle << 32u) };
+			const uint64_t high{ highHigh + (lowHigh >> 32u) + (highLow >> 32u) + (middle >> 32u) };
+			return low ^ high;
+#endif
+		}
+
+		inline uint64_t loadLittleEndian64(const byte* ptr) {
+			uint64_t value;
+			memcpy(&value, ptr, sizeof(value));
+			if constexpr (std::endian::native == std::endian::big)
+				value = byteswap(value);
+			return value;
+		}
+
+		//Incremental hash over a byte stream, the result does not depend on how the input is split between update calls.
+		class StreamHasher {
+			static constexpr size_t BLOCK_SIZE{ 16u };
+			uint64_t a;
+			uint64_t b;
+			uint64_t length{ 0u };
+			byte buffer[BLOCK_SIZE];
+			size_t buffered{ 0u };
+
+			void block(const byte* ptr) {
+				const uint64_t x{ loadLittleEndian64(ptr) };
+				const uint64_t y{ loadLittleEndian64(ptr + sizeof(uint64_t)) };
+				a = (std::rotl(a, 27) ^ mum(x ^ P0, y ^ P1)) * P2;
+				b = (std::rotl(b, 31) + mum(x ^ P2, std::rotl(y, 32) ^ P3)) * P0;
+			}
+
+		public:
+			explicit StreamHasher(uint64_t seed)
+				: a{ seed ^ P0 }, b{ std::rotl(seed, 32) ^ P1 } {
+			}
+
+			void update(const void* data, size_t size) {
+				const byte* ptr{ static_cast<const byte*>(data) };
+				length += size;
+				if (buffered != 0u) {
+					const size_t copySize{ std::min(size, BLOCK_SIZE - buffered) };
+					memcpy(buffer + buffered, ptr, copySize);
+					buffered += copySize;
+					ptr += copySize;
+					size -= copySize;
+					if (buffered < BLOCK_SIZE)
+						return;
+					block(buffer);
+					buffered = 0u;
+				}
+				while (size >= BLOCK_SIZE) {
+					block(ptr);
+					ptr += BLOCK_SIZE;
+					size -= BLOCK_SIZE;
+				}
+				if (size != 0u)
+					memcpy(buffer, ptr, size);
+				buffered = size;
+			}
+
+			void putByte(uint8_t value) {
+				if (buffered < BLOCK_SIZE - 1u) { //Fast path for the many single byte tag ids.
+					buffer[buffered++] = static_cast<byte>(value);
+					++length;
+					return;
+				}
+				update(&value, sizeof(value));
+			}
+
+			//Values are hashed in their big endian encoding, which is also how they are stored in raw NBT data.
+			template<typename valueType>
+			void putBigEndian(valueType value) {
+				const valueType flipped{ byteswap(value) };
+				update(&flipped, sizeof(flipped));
+			}
+
+			void putHash(const NBT_Hash128& hash) {
+				byte data[2u * sizeof(uint64_t)];
+				const uint64_t low{ std::endian::native == std::endian::big ? byteswap(hash.low) : hash.low };
+				const uint64_t high{ std::endian::native == std::endian::big ? byteswap(hash.high) : hash.high };
+				memcpy(data, &low, sizeof(low));
+				memcpy(data + sizeof(low), &high, sizeof(high));
+				update(data, sizeof(data));
+			}
+
+			[[nodiscard]]
+			NBT_Hash128 finish() {
+				memset(buffer + buffered, 0, BLOCK_SIZE - buffered);
+				block(buffer);
+				a ^= length * P1;
+				b ^= length;
+				const uint64_t mixedA{ mum(a ^ P0, b ^ P3) };
+				const uint64_t mixedB{ mum(b ^ P1, a ^ P2) };
+				const uint64_t low{ mixedA ^ mum(mixedA ^ P3, mixedB ^ P0) };
+				const uint64_t high{ mixedB ^ mum(mixedB ^ P2, low ^ P1) };
+				return { low, high };
+			}
+		};
+
+		constexpr bool isContainer(TagID id) {
+			return id == TagID::List || id == TagID::Compound;
+		}
+
+		template<typename valueType>
+		void putArray(StreamHasher& hasher, const std::pmr::vector<valueType>& values) {
+			hasher.putBigEndian(static_cast<int32_t>(values.size()));
+			if constexpr (sizeof(valueType) == 1u) {
+				hasher.update(values.data(), values.size());
+			}
+			else {
+				//Convert to big endian in blocks, so the stream matches the raw encoding.
+				std::array<valueType, 64u> flipped;
+				for (size_t i = 0u; i < values.size(); i += flipped.size()) {
+					const size_t count{ std::min(flipped.size(), values.size() - i) };
+					for (size_t j = 0u; j < count; ++j)
+						flipped[j] = byteswap(values[i + j]);
+					hasher.update(flipped.data(), count * sizeof(valueType));
+				}
+			}
+		}
+
+		//Tags hold UTF-8 while encoded documents hold MUTF-8, strings are hashed in their encoded form so both hashes match.
+		void putString(StreamHasher& hasher, std::string_view str) {
+			bool needsConversion{ false };
+			size_t length{ str.size() };
+			try {
+				length = scanUTF8(str.data(), str.size(), needsConversion);
+			}
+			catch (const std::runtime_error&) {
+				//Such a string can not be encoded, hash its bytes as they are.
+				needsConversion = false;
+				length = str.size();
+			}
+			hasher.putBigEndian(static_cast<uint16_t>(length));
+			if (!needsConversion) {
+				hasher.update(str.data(), str.size());
+				return;
+			}
+			thread_local std::string converted;
+			converted.resize(length);
+			convertUTF8ToMUTF8(str.data(), str.size(), converted.data());
+			hasher.update(converted.data(), converted.size());
+		}
+
+		//Stream layout shared by TreeHasher and RawHasher:
+		//numbers, arrays and strings contribute their encoded payload, lists and compounds contribute the hash
+		//of their own stream (id followed by payload), which is what allows caching them.
+		//Ordered compounds contribute each entry's id, name and payload followed by TAG_End, order insensitive
+		//compounds the entry count and the lane-wise sum of the separately hashed entries.
+		class TreeHasher {
+			const NBT_HashOptions& options;
+			std::unordered_map<const NBT_TagBase*, NBT_Hash128>* cache;
+
+			void putEntry(StreamHasher& hasher, const NBT_TagBase* entry) {
+				hasher.putByte(static_cast<uint8_t>(entry->id));
+				putString(hasher, entry->name);
+				putElement(hasher, entry);
+			}
+
+			void putElement(StreamHasher& hasher, const NBT_TagBase* tag) {
+				if (isContainer(tag->id))
+					hasher.putHash(nodeHash(tag));
+				else
+					putPayload(hasher, tag);
+			}
+
+			void putPayload(StreamHasher& hasher, const NBT_TagBase* tag) {
+				switch (tag->id) {
+					using enum TagID;
+				case Byte:
+					hasher.putBigEndian(static_cast<const Byte_Tag*>(tag)->value);
+					break;
+				case Short:
+					hasher.putBigEndian(static_cast<const Short_Tag*>(tag)->value);
+					break;
+				case Int:
+					hasher.putBigEndian(static_cast<const Int_Tag*>(tag)->value);
+					break;
+				case Long:
+					hasher.putBigEndian(static_cast<const Long_Tag*>(tag)->value);
+					break;
+				case Float:
+					hasher.putBigEndian(static_cast<const Float_Tag*>(tag)->value);
+					break;
+				case Double:
+					hasher.putBigEndian(static_cast<const Double_Tag*>(tag)->value);
+					break;
+				case Byte_Array:
+					putArray(hasher, static_cast<const ByteArray_Tag*>(tag)->values);
+					break;
+				case Int_Array:
+					putArray(hasher, static_cast<const IntArray_Tag*>(tag)->values);
+					break;
+				case Long_Array:
+					putArray(hasher, static_cast<const LongArray_Tag*>(tag)->values);
+					break;
+				case String:
+					putString(hasher, static_cast<const String_Tag*>(tag)->value);
+					break;
+				case List: {
+					const List_Tag* list{ static_cast<const List_Tag*>(tag) };
+					hasher.putByte(static_cast<uint8_t>(list->listType));
+					hasher.putBigEndian(static_cast<int32_t>(list->values.size()));
+					for (const NBT_TagBase* element : list->values)
+						putElement(hasher, element);
+					break;
+				}
+				case Compound: {
+					const Compound_Tag* compound{ static_cast<const Compound_Tag*>(tag) };
+					if (!options.orderInsensitive) {
+						for (const NBT_TagBase* entry : compound->values)
+							putEntry(hasher, entry);
+						hasher.putByte(static_cast<uint8_t>(TagID::End));
+						break;
+					}
+					NBT_Hash128 sum;
+					for (const NBT_TagBase* entry : compound->values) {
+						StreamHasher entryHasher{ options.seed };
+						putEntry(entryHasher, entry);
+						const NBT_Hash128 entryHash{ entryHasher.finish() };
+						sum.low += entryHash.low;
+						sum.high += entryHash.high;
+					}
+					hasher.putBigEndian(static_cast<int32_t>(compound->values.size()));
+					hasher.putHash(sum);
+					break;
+				}
+				default:
+					break;
+				}
+			}
+
+		public:
+			TreeHasher(const NBT_HashOptions& options, std::unordered_map<const NBT_TagBase*, NBT_Hash128>* cache)
+				: options{ options }, cache{ cache } {
+			}
+
+			NBT_Hash128 nodeHash(const NBT_TagBase* tag) {
+				const bool cacheable{ cache && isContainer(tag->id) };
+				if (cacheable) {
+					const auto it{ cache->find(tag) };
+					if (it != cache->end())
+						return it->second;
+				}
+
+				StreamHasher hasher{ options.seed };
+				hasher.putByte(static_cast<uint8_t>(tag->id));
+				putPayload(hasher, tag);
+				const NBT_Hash128 hash{ hasher.finish() };
+
+				if (cacheable)
+					cache->emplace(tag, hash);
+				return hash;
+			}
+		};
+
+		class RawHasher {
+			const NBT_HashOptions& options;
+			const byte* data;
+			size_t size;
+			size_t cursor{ 0u };
+
+			const byte* take(size_t bytes) {
+				if (size - cursor < bytes)
+					throw std::out_of_range("Data ran out while hashing NBT data.");
+				const byte* ptr{ data + cursor };
+				cursor += bytes;
+				return ptr;
+			}
+
+			template<typename T>
+			T read() {
+				return copyAndFlipBytes<T>(const_cast<byte*>(take(sizeof(T))));
+			}
+
+			TagID readTagID() {
+				const TagID id{ static_cast<TagID>(read<uint8_t>()) };
+				if (id > TagID::Long_Array)
+					throw std::runtime_error("Invalid tag id encountered while hashing NBT data.");
+				return id;
+			}
+
+			//Decoding accepts NUL as a single byte like Java does, while tags encode it as C0 80. Such strings are hashed in the encoded form.
+			void putString(StreamHasher& hasher) {
+				const uint16_t length{ read<uint16_t>() };
+				const byte* str{ take(length) };
+				const size_t nulCount{ size_t(std::count(str, str + length, byte{ 0u })) };
+				hasher.putBigEndian(static_cast<uint16_t>(length + nulCount));
+				if (nulCount == 0u) {
+					hasher.update(str, length);
+					return;
+				}
+				constexpr byte encodedNul[]{ byte{ 0xc0u }, byte{ 0x80u } };
+				for (const byte* end{ str + length }; str != end;) {
+					const byte* nul{ std::find(str, end, byte{ 0u }) };
+					hasher.update(str, size_t(nul - str));
+					if (nul == end)
+						break;
+					hasher.update(encodedNul, sizeof(encodedNul));
+					str = nul + 1;
+				}
+			}
+
+			void putEntry(StreamHasher& hasher, TagID id, size_t depth) {
+				hasher.putByte(static_cast<uint8_t>(id));
+				putString(hasher);
+				putElement(hasher, id, depth);
+			}
+
+			void putElement(StreamHasher& hasher, TagID id, size_t depth) {
+				if (isContainer(id))
+					hasher.putHash(nodeHash(id, depth + 1u));
+				else
+					putPayload(hasher, id, depth);
+			}
+
+			void putArray(StreamHasher& hasher, size_t valueSize) {
+				const int32_t count{ read<int32_t>() };
+				if (count < 0)
+					throw std::runtime_error("Negative array length encountered while hashing NBT data.");
+				hasher.putBigEndian(count);
+				hasher.update(take(size_t(count) * valueSize), size_t(count) * valueSize);
+			}
+
+			void putPayload(StreamHasher& hasher, TagID id, size_t depth) {
+				switch (id) {
+					using enum TagID;
+				case Byte:
+				case Short:
+				case Int:
+				case Long:
+				case Float:
+				case Double:
+					hasher.update(take(minimumPayloadSize(id)), minimumPayloadSize(id));
+					break;
+				case Byte_Array:
+					putArray(hasher, sizeof(int8_t));
+					break;
+				case Int_Array:
+					putArray(hasher, sizeof(int32_t));
+					break;
+				case Long_Array:
+					putArray(hasher, sizeof(int64_t));
+					break;
+				case String:
+					putString(hasher);
+					break;
+				case List: {
+					const TagID listType{ readTagID() };
+					const int32_t count{ read<int32_t>() };
+					if (count < 0)
+						throw std::runtime_error("Negative list length encountered while hashing NBT data.");
+					if (listType == End && count != 0)
+						throw std::runtime_error("List with elements of type TAG_End encountered while hashing NBT data.");
+					hasher.putByte(static_cast<uint8_t>(listType));
+					hasher.putBigEndian(count);
+					if (listType >= Byte && listType <= Double) { //Fixed size elements are contiguous.
+						hasher.update(take(size_t(count) * minimumPayloadSize(listType)), size_t(count) * minimumPayloadSize(listType));
+						break;
+					}
+					for (int32_t i = 0; i < count; ++i)
+						putElement(hasher, listType, depth);
+					break;
+				}
+				case Compound: {
+					if (!options.orderInsensitive) {
+						for (TagID entryType{ readTagID() }; entryType != End; entryType = readTagID())
+							putEntry(hasher, entryType, depth);
+						hasher.putByte(static_cast<uint8_t>(End));
+						break;
+					}
+					NBT_Hash128 sum;
+					int32_t count{ 0 };
+					for (TagID entryType{ readTagID() }; entryType != End; entryType = readTagID()) {
+						StreamHasher entryHasher{ options.seed };
+						putEntry(entryHasher, entryType, depth);
+						const NBT_Hash128 entryHash{ entryHasher.finish() };
+						sum.low += entryHash.low;
+						sum.high += entryHash.high;
+						++count;
+					}
+					hasher.putBigEndian(count);
+					hasher.putHash(sum);
+					break;
+				}
+				default:
+					break;
+				}
+			}
+
+		public:
+			RawHasher(const NBT_HashOptions& options, const byte* data, size_t size)
+				: options{ options }, data{ data }, size{ size } {
+			}
+
+			NBT_Hash128 nodeHash(TagID id, size_t depth) {
+				if (depth > MAX_RAW_HASH_DEPTH)
+					throw std::runtime_error("NBT data is nested too deeply to be hashed.");
+				StreamHasher hasher{ options.seed };
+				hasher.putByte(static_cast<uint8_t>(id));
+				putPayload(hasher, id, depth);
+				return hasher.finish();
+			}
+
+			NBT_Hash128 rootHash() {
+				if (readTagID() != TagID::Compound)
+					throw std::runtime_error("Root tag must be TAG_Compound.");
+				take(read<uint16_t>()); //The name of the root is not part of the hash.
+				return nodeHash(TagID::Compound, 1u);
+			}
+		};
+
+		template<typename tagType>
+		bool valuesEqual(const NBT_TagBase* a, const NBT_TagBase* b) {
+			const auto& valueA{ static_cast<const tagType*>(a)->value };
+			const auto& valueB{ static_cast<const tagType*>(b)->value };
+			return memcmp(&valueA, &valueB, sizeof(valueA)) == 0; //Bitwise, like the hash.
+		}
+
+		template<typename tagType>
+		bool arraysEqual(const NBT_TagBase* a, const NBT_TagBase* b) {
+			const auto& valuesA{ static_cast<const tagType*>(a)->values };
+			const auto& valuesB{ static_cast<const tagType*>(b)->values };
+			return valuesA.size() == valuesB.size()
+				&& (valuesA.empty() || memcmp(valuesA.data(), valuesB.data(), valuesA.size() * sizeof(valuesA[0])) == 0);
+		}
+
+		//Order insensitive comparison of compounds holding the same name more than once, which indexMap can not look up.
+		//The entries are compared as multisets like hashTag does: every entry of a is matched with a distinct entry of b.
+		bool duplicateEntriesEqual(const Compound_Tag* a, const Compound_Tag* b) {
+			std::vector<bool> matched(b->values.size(), false);
+			for (const NBT_TagBase* entryA : a->values) {
+				bool found{ false };
+				for (size_t i = 0u; i < b->values.size() && !found; ++i) {
+					const NBT_TagBase* entryB{ b->values[i] };
+					if (!matched[i] && entryA->name == entryB->name && tagsEqual(entryA, entryB, true))
+						matched[i] = found = true;
+				}
+				if (!found)
+					return false;
+			}
+			return true;
+		}
+	}
+
+	NBT_Hash128 hashBytes(const void* data, size_t size, uint64_t seed) {
+		StreamHasher hasher{ seed };
+		hasher.update(data, size);
+		return hasher.finish();
+	}
+
+	NBT_Hash128 hashTag(const NBT_TagBase* tag, const NBT_HashOptions& options) {
+		return TreeHasher{ options, nullptr }.nodeHash(tag);
+	}
+
+	NBT_Hash128 hashRawNBT(const void* dataPtr, size_t dataSize, const NBT_HashOptions& options) {
+		return RawHasher{ options, static_cast<const byte*>(dataPtr), dataSize }.rootHash();
+	}
+
+	bool tagsEqual(const NBT_TagBase* a, const NBT_TagBase* b, bool orderInsensitive) {
+		if (a->id != b->id)
+			return false;
+
+		switch (a->id) {
+			using enum TagID;
+		case Byte:
+			return valuesEqual<Byte_Tag>(a, b);
+		case Short:
+			return valuesEqual<Short_Tag>(a, b);
+		case Int:
+			return valuesEqual<Int_Tag>(a, b);
+		case Long:
+			return valuesEqual<Long_Tag>(a, b);
+		case Float:
+			return valuesEqual<Float_Tag>(a, b);
+		case Double:
+			return valuesEqual<Double_Tag>(a, b);
+		case Byte_Array:
+			return arraysEqual<ByteArray_Tag>(a, b);
+		case Int_Array:
+			return arraysEqual<IntArray_Tag>(a, b);
+		case Long_Array:
+			return arraysEqual<LongArray_Tag>(a, b);
+		case String:
+			return static_cast<const String_Tag*>(a)->value == static_cast<const String_Tag*>(b)->value;
+		case List: {
+			const List_Tag* listA{ static_cast<const List_Tag*>(a) };
+			const List_Tag* listB{ static_cast<const List_Tag*>(b) };
+			if (listA->listType != listB->listType || listA->values.size() != listB->values.size())
+				return false;
+			for (size_t i = 0u; i < listA->values.size(); ++i) {
+				if (!tagsEqual(listA->values[i], listB->values[i], orderInsensitive))
+					return false;
+			}
+			return true;
+		}
+		case Compound: {
+			const Compound_Tag* compoundA{ static_cast<const Compound_Tag*>(a) };
+			const Compound_Tag* compoundB{ static_cast<const Compound_Tag*>(b) };
+			if (compoundA->values.size() != compoundB->values.size())
+				return false;
+			if (orderInsensitive && (compoundA->indexMap.size() != compoundA->values.size() || compoundB->indexMap.size() != compoundB->values.size()))
+				return duplicateEntriesEqual(compoundA, compoundB);
+			for (size_t i = 0u; i < compoundA->values.size(); ++i) {
+				const NBT_TagBase* entryA{ compoundA->values[i] };
+				const NBT_TagBase* entryB{ compoundB->values[i] };
+				if (orderInsensitive) {
+					const auto it{ compoundB->indexMap.find(entryA->name) };
+					if (it == compoundB->indexMap.end())
+						return false;
+					entryB = compoundB->values[it->second];
+				}
+				if (entryA->name != entryB->name || !tagsEqual(entryA, entryB, orderInsensitive))
+					return false;
+			}
+			return true;
+		}
+		default:
+			return true;
+		}
+	}
+
+	NBT_Hash128 TagHashCache::hash(const NBT_TagBase* tag) {
+		return TreeHasher{ options, &hashes }.nodeHash(tag);
+	}
+
+	bool TagHashCache::equal(const NBT_TagBase* a, const NBT_TagBase* b) {
+		if (a == b)
+			return true;
+		return hash(a) == hash(b) && tagsEqual(a, b, options.orderInsensitive);
+	}
+}
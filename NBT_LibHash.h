@@ -0,0 +1,79 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <unordered_map>
+
+#include "NBT_Lib.h"
+
+namespace NBT_Lib {
+	struct NBT_Hash128 {
+		uint64_t low{ 0u };
+		uint64_t high{ 0u };
+
+		[[nodiscard]]
+		constexpr uint64_t to64() const {
+			return low;
+		}
+		constexpr bool operator==(const NBT_Hash128& other) const = default;
+	};
+
+	struct NBT_HashOptions {
+		//Hash compound entries independently of their order, so compounds holding the same entries hash equally.
+		bool orderInsensitive{ false };
+		uint64_t seed{ 0u };
+	};
+
+	//Non cryptographic 128 bit hash of a byte range, suitable for content addressing and deduplication.
+	[[nodiscard]]
+	NBT_Hash128 hashBytes(const void* data, size_t size, uint64_t seed = 0u);
+
+	//Structural hash of a tag: its type and payload, including the names and values of everything nested in it, but not its own name.
+	//Numbers are hashed by their bit pattern, so -0.0 and 0.0 differ and NaNs with the same bits are equal, matching tagsEqual.
+	[[nodiscard]]
+	NBT_Hash128 hashTag(const NBT_TagBase* tag, const NBT_HashOptions& options = {});
+
+	//Computes the same hash as hashTag on the root compound of an encoded NBT document, without parsing it.
+	//Throws std::out_of_range or std::runtime_error if the document is malformed.
+	[[nodiscard]]
+	NBT_Hash128 hashRawNBT(const void* dataPtr, size_t dataSize, const NBT_HashOptions& options = {});
+
+	//Structural equality matching hashTag, the names of a and b themselves are not compared.
+	[[nodiscard]]
+	bool tagsEqual(const NBT_TagBase* a, const NBT_TagBase* b, bool orderInsensitive = false);
+
+	//Caches the hashes of lists and compounds, so hashing a tree again after changing part of it only rehashes what changed.
+	//The cache is keyed by tag address and does not observe modifications: after changing a tag call invalidate
+	//for it and every list or compound containing it. A tag allocated where a freed tag used to be would be given the
+	//hash of the freed one, so invalidate tags before freeing them, or clear the cache. Not thread safe.
+	class TagHashCache {
+		NBT_HashOptions options;
+		std::unordered_map<const NBT_TagBase*, NBT_Hash128> hashes;
+
+	public:
+		explicit TagHashCache(const NBT_HashOptions& options = {})
+			: options{ options } {
+		}
+
+		[[nodiscard]]
+		NBT_Hash128 hash(const NBT_TagBase* tag);
+
+		//Compares the cached hashes first and only compares the trees when they match.
+		[[nodiscard]]
+		bool equal(const NBT_TagBase* a, const NBT_TagBase* b);
+
+		void invalidate(const NBT_TagBase* tag) {
+			hashes.erase(tag);
+		}
+		void clear() {
+			hashes.clear();
+		}
+		[[nodiscard]]
+		size_t size() const {
+			return hashes.size();
+		}
+		[[nodiscard]]
+		const NBT_HashOptions& getOptions() const {
+			return options;
+		}
+	};
+}
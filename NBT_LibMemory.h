@@ -0,0 +1,88 @@
+#pragma once
+#include <memory_resource>
+#include <new>
+#include <cstddef>
+
+namespace NBT_Lib {
+	//Thrown by BudgetMemoryResource when an allocation would exceed its budget.
+	//Derives from std::bad_alloc, so code that already handles running out of memory keeps working.
+	class MemoryBudgetExceeded : public std::bad_alloc {
+	public:
+		size_t requested; //Size of the allocation that was refused.
+		size_t budget;
+		size_t used; //Bytes outstanding when the allocation was refused.
+
+		MemoryBudgetExceeded(size_t requested, size_t budget, size_t used) noexcept
+			: requested{ requested }, budget{ budget }, used{ used } {
+		}
+
+		const char* what() const noexcept override {
+			return "NBT memory budget exceeded";
+		}
+	};
+
+	//Memory resource enforcing a hard limit on the bytes outstanding from an upstream resource.
+	//Allocations that would exceed the budget throw MemoryBudgetExceeded before the upstream resource is touched,
+	//and the parser returns everything it allocated when it throws, so a failed parse leaves getUsed() where it was.
+	//For exact accounting put it directly between the parser and an arena, e.g. BudgetMemoryResource over a monotonic_buffer_resource.
+	//Like std::pmr::unsynchronized_pool_resource it is not thread safe, use one instance per thread.
+	class BudgetMemoryResource : public std::pmr::memory_resource {
+		std::pmr::memory_resource* upstream;
+		size_t budget;
+		size_t used{ 0u };
+		size_t peak{ 0u };
+
+	public:
+		explicit BudgetMemoryResource(size_t budget, std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) noexcept
+			: upstream{ upstream }, budget{ budget } {
+		}
+		BudgetMemoryResource(const BudgetMemoryResource&) = delete;
+		BudgetMemoryResource& operator=(const BudgetMemoryResource&) = delete;
+
+		[[nodiscard]]
+		size_t getBudget() const noexcept {
+			return budget;
+		}
+		//Changing the budget does not affect memory that has already been allocated.
+		void setBudget(size_t newBudget) noexcept {
+			budget = newBudget;
+		}
+		[[nodiscard]]
+		size_t getUsed() const noexcept {
+			return used;
+		}
+		[[nodiscard]]
+		size_t getRemaining() const noexcept {
+			return used < budget ? budget - used : 0u;
+		}
+		[[nodiscard]]
+		size_t getPeak() const noexcept {
+			return peak;
+		}
+		[[nodiscard]]
+		std::pmr::memory_resource* getUpstream() const noexcept {
+			return upstream;
+		}
+
+	protected:
+		void* do_allocate(size_t bytes, size_t alignment) override {
+			if (bytes > getRemaining())
+				throw MemoryBudgetExceeded(bytes, budget, used);
+
+			void* ptr{ upstream->allocate(bytes, alignment) };
+			used += bytes;
+			if (used > peak)
+				peak = used;
+			return ptr;
+		}
+
+		void do_deallocate(void* ptr, size_t bytes, size_t alignment) override {
+			upstream->deallocate(ptr, bytes, alignment);
+			used -= bytes;
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+			return this == &other;
+		}
+	};
+}
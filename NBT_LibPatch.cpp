@@ -0,0 +1,396 @@
+#include "NBT_LibPatch.h"
+#include <array>
+#include <charconv>
+
+#include "NBT_LibValidate.h"
+
+namespace NBT_Lib {
+	namespace {
+		constexpr bool isNumberType(TagID id) {
+			return id >= TagID::Byte && id <= TagID::Double;
+		}
+
+		constexpr TagID arrayElementType(TagID id) {
+			switch (id) {
+				using enum TagID;
+			case Byte_Array:
+				return Byte;
+			case Int_Array:
+				return Int;
+			case Long_Array:
+				return Long;
+			default:
+				return End;
+			}
+		}
+
+		//Forward only cursor over an encoded document, skipping tags iteratively with a fixed size stack.
+		class RawWalker {
+			struct SkipFrame {
+				bool isList;
+				TagID listType;
+				uint32_t remaining;
+			};
+
+			byte* data;
+			size_t size;
+			size_t cursor{ 0u };
+
+		public:
+			RawWalker(byte* data, size_t size)
+				: data{ data }, size{ size } {
+			}
+
+			byte* take(size_t bytes) {
+				if (size - cursor < bytes)
+					throw std::out_of_range("Data ran out while searching NBT data.");
+				byte* ptr{ data + cursor };
+				cursor += bytes;
+				return ptr;
+			}
+
+			template<typename T>
+			T read() {
+				return copyAndFlipBytes<T>(take(sizeof(T)));
+			}
+
+			TagID readTagID() {
+				const TagID id{ static_cast<TagID>(read<uint8_t>()) };
+				if (id > TagID::Long_Array)
+					throw std::runtime_error("Invalid tag id encountered while searching NBT data.");
+				return id;
+			}
+
+			//Reads an array or list length.
+			size_t readCount() {
+				const int32_t count{ read<int32_t>() };
+				if (count < 0)
+					throw std::runtime_error("Negative length encountered while searching NBT data.");
+				return size_t(count);
+			}
+
+			//Reads the element type and length of a list. Only empty lists may have elements of type TAG_End, which have no payload to bound their count.
+			size_t readListHeader(TagID& out_elementType) {
+				out_elementType = readTagID();
+				const size_t count{ readCount() };
+				if (out_elementType == TagID::End && count != 0u)
+					throw std::runtime_error("List with elements of type TAG_End encountered while searching NBT data.");
+				return count;
+			}
+
+			void skipPayload(TagID id) {
+				std::array<SkipFrame, NBT_MAX_DEPTH> stack;
+				size_t depth{ 0u };
+
+				//Skips numbers, strings, arrays and lists of those directly, lists of lists or compounds and compounds are pushed.
+				const auto skipOrPush{ [&](TagID id) {
+					switch (id) {
+						using enum TagID;
+					case Byte_Array:
+					case Int_Array:
+					case Long_Array: {
+						const size_t count{ readCount() };
+						const size_t elementSize{ minimumPayloadSize(arrayElementType(id)) };
+						if (count > (size - cursor) / elementSize)
+							throw std::out_of_range("Data ran out while searching NBT data.");
+						take(count * elementSize);
+						return;
+					}
+					case String:
+						take(read<uint16_t>());
+						return;
+					case List: {
+						TagID listType;
+						const size_t count{ readListHeader(listType) };
+						if (isNumberType(listType)) {
+							if (count > (size - cursor) / minimumPayloadSize(listType))
+								throw std::out_of_range("Data ran out while searching NBT data.");
+							take(count * minimumPayloadSize(listType));
+							return;
+						}
+						if (count == 0u)
+							return;
+						if (depth == stack.size())
+							throw std::runtime_error("NBT data exceeds the maximum nesting depth.");
+						stack[depth++] = { true, listType, static_cast<uint32_t>(count) };
+						return;
+					}
+					case Compound:
+						if (depth == stack.size())
+							throw std::runtime_error("NBT data exceeds the maximum nesting depth.");
+						stack[depth++] = { false, End, 0u };
+						return;
+					default:
+						take(minimumPayloadSize(id));
+						return;
+					}
+				} };
+
+				skipOrPush(id);
+				while (depth != 0u) {
+					SkipFrame& frame{ stack[depth - 1u] };
+					if (frame.isList) {
+						if (frame.remaining == 0u) {
+							--depth;
+							continue;
+						}
+						--frame.remaining;
+						skipOrPush(frame.listType);
+					}
+					else {
+						const TagID entryID{ readTagID() };
+						if (entryID == TagID::End) {
+							--depth;
+							continue;
+						}
+						take(read<uint16_t>());
+						skipOrPush(entryID);
+					}
+				}
+			}
+
+			//Moves to the payload of the entry with the given name in the compound at the cursor, returns false if there is none.
+			bool findEntry(std::string_view name, TagID& out_id) {
+				while (true) {
+					const TagID id{ readTagID() };
+					if (id == TagID::End)
+						return false;
+					const uint16_t nameLength{ read<uint16_t>() };
+					const byte* namePtr{ take(nameLength) };
+					if (nameLength == name.size() && memcmp(namePtr, name.data(), nameLength) == 0) {
+						out_id = id;
+						return true;
+					}
+					skipPayload(id);
+				}
+			}
+
+			//Moves to element index of the list or array at the cursor, returns false if it has fewer elements.
+			bool findElement(size_t index, TagID& inout_id) {
+				TagID elementType{ arrayElementType(inout_id) };
+				const size_t count{ inout_id == TagID::List ? readListHeader(elementType) : readCount() };
+				if (index >= count)
+					return false;
+
+				if (isNumberType(elementType)) {
+					if (index > (size - cursor) / minimumPayloadSize(elementType))
+						throw std::out_of_range("Data ran out while searching NBT data.");
+					take(index * minimumPayloadSize(elementType));
+				}
+				else {
+					for (size_t i = 0u; i < index; ++i)
+						skipPayload(elementType);
+				}
+				inout_id = elementType;
+				return true;
+			}
+
+			NBT_RawTag describe(TagID id) {
+				NBT_RawTag tag{ nullptr, id, id, 1u };
+				switch (id) {
+					using enum TagID;
+				case Byte_Array:
+				case Int_Array:
+				case Long_Array:
+					tag.elementType = arrayElementType(id);
+					tag.count = readCount();
+					break;
+				case List:
+					tag.count = readListHeader(tag.elementType);
+					break;
+				default:
+					break;
+				}
+
+				tag.payload = data + cursor;
+				if (isNumberType(tag.elementType)) {
+					//Make sure all values lie inside the buffer, so patching them is safe.
+					if (tag.count > (size - cursor) / minimumPayloadSize(tag.elementType))
+						throw std::out_of_range("Data ran out while searching NBT data.");
+				}
+				else if (id == TagID::String) {
+					//Same for the length and characters of strings, so they can be read from the payload.
+					if (size - cursor < sizeof(uint16_t) || size - cursor - sizeof(uint16_t) < copyAndFlipBytes<uint16_t>(tag.payload))
+						throw std::out_of_range("Data ran out while searching NBT data.");
+				}
+				return tag;
+			}
+
+			size_t getCursor() const {
+				return cursor;
+			}
+			size_t remaining() const {
+				return size - cursor;
+			}
+		};
+
+		struct PathSegment {
+			std::string_view name;
+			size_t index{ 0u };
+			bool isIndex{ false };
+		};
+
+		//Removes the first name or [index] from path. Throws std::invalid_argument if an index is malformed.
+		PathSegment nextPathSegment(std::string_view& path) {
+			PathSegment segment;
+			if (path.front() == '[') {
+				const size_t close{ path.find(']') };
+				if (close == std::string_view::npos
+					|| std::from_chars(path.data() + 1, path.data() + close, segment.index).ec != std::errc{})
+					throw std::invalid_argument("Invalid index in NBT path.");
+				path.remove_prefix(close + 1u);
+				segment.isIndex = true;
+			}
+			else {
+				if (path.front() == '.')
+					path.remove_prefix(1u);
+				const size_t end{ std::min(path.find('.'), path.find('[')) };
+				segment.name = path.substr(0u, end);
+				path.remove_prefix(std::min(end, path.size()));
+			}
+			return segment;
+		}
+
+		//Follows path from the payload of a compound at the walker's cursor.
+		NBT_RawTag findPath(RawWalker& walker, std::string_view path) {
+			TagID current{ TagID::Compound };
+			while (!path.empty()) {
+				const PathSegment segment{ nextPathSegment(path) };
+				if (segment.isIndex) {
+					if (current != TagID::List && arrayElementType(current) == TagID::End)
+						return {};
+					if (!walker.findElement(segment.index, current))
+						return {};
+				}
+				else {
+					if (current != TagID::Compound)
+						return {};
+					if (!walker.findEntry(segment.name, current))
+						return {};
+				}
+			}
+			return walker.describe(current);
+		}
+
+		//Finds the child of node matching an entry name or element index, nullptr if there is none.
+		const NBT_RawPathSet::Node* findChild(std::span<const NBT_RawPathSet::Node> nodes, const NBT_RawPathSet::Node& node, std::string_view name, size_t index, bool isIndex) {
+			for (const uint32_t child : node.children) {
+				const NBT_RawPathSet::Node& candidate{ nodes[child] };
+				if (candidate.isIndex == isIndex && (isIndex ? candidate.index == index : candidate.name == name))
+					return &candidate;
+			}
+			return nullptr;
+		}
+
+		//Resolves the paths ending at or below node for the tag of type id at the walker's cursor, and moves past its payload.
+		//Only recurses as deep as the paths go, everything else is skipped iteratively.
+		void walkPathNode(RawWalker& walker, TagID id, std::span<const NBT_RawPathSet::Node> nodes, const NBT_RawPathSet::Node& node, std::span<NBT_RawTag> out, size_t depth) {
+			if (depth > NBT_MAX_DEPTH)
+				throw std::runtime_error("NBT data exceeds the maximum nesting depth.");
+			if (!node.targets.empty()) {
+				RawWalker describer{ walker };
+				const NBT_RawTag tag{ describer.describe(id) };
+				for (const uint32_t target : node.targets) {
+					if (!out[target]) //Of several entries with the same name the first one is used, like findRawTag does.
+						out[target] = tag;
+				}
+			}
+			if (node.children.empty()) {
+				walker.skipPayload(id);
+				return;
+			}
+
+			if (id == TagID::Compound) {
+				while (true) {
+					const TagID entryID{ walker.readTagID() };
+					if (entryID == TagID::End)
+						return;
+					const uint16_t nameLength{ walker.read<uint16_t>() };
+					const std::string_view name{ reinterpret_cast<const char*>(walker.take(nameLength)), nameLength };
+					if (const NBT_RawPathSet::Node* child{ findChild(nodes, node, name, 0u, false) })
+						walkPathNode(walker, entryID, nodes, *child, out, depth + 1u);
+					else
+						walker.skipPayload(entryID);
+				}
+			}
+
+			TagID elementType{ arrayElementType(id) };
+			if (id != TagID::List && elementType == TagID::End) {
+				walker.skipPayload(id);
+				return;
+			}
+			const size_t count{ id == TagID::List ? walker.readListHeader(elementType) : walker.readCount() };
+			if (isNumberType(elementType)) {
+				//Numbers have a fixed size, so the selected elements are located directly.
+				const size_t elementSize{ minimumPayloadSize(elementType) };
+				if (count > walker.remaining() / elementSize)
+					throw std::out_of_range("Data ran out while searching NBT data.");
+				for (const uint32_t child : node.children) {
+					const NBT_RawPathSet::Node& element{ nodes[child] };
+					if (!element.isIndex || element.index >= count)
+						continue;
+					RawWalker elementWalker{ walker };
+					elementWalker.take(element.index * elementSize);
+					walkPathNode(elementWalker, elementType, nodes, element, out, depth + 1u);
+				}
+				walker.take(count * elementSize);
+				return;
+			}
+			for (size_t i = 0u; i < count; ++i) {
+				if (const NBT_RawPathSet::Node* child{ findChild(nodes, node, {}, i, true) })
+					walkPathNode(walker, elementType, nodes, *child, out, depth + 1u);
+				else
+					walker.skipPayload(elementType);
+			}
+		}
+	}
+
+	NBT_RawPathSet::NBT_RawPathSet(std::span<const std::string_view> paths)
+		: nodes(1u), pathCount{ paths.size() } {
+
+		for (size_t i = 0u; i < paths.size(); ++i) {
+			std::string_view path{ paths[i] };
+			uint32_t current{ 0u };
+			while (!path.empty()) {
+				const PathSegment segment{ nextPathSegment(path) };
+				const Node* child{ findChild(nodes, nodes[current], segment.name, segment.index, segment.isIndex) };
+				if (child) {
+					current = static_cast<uint32_t>(child - nodes.data());
+					continue;
+				}
+				nodes[current].children.push_back(static_cast<uint32_t>(nodes.size()));
+				current = static_cast<uint32_t>(nodes.size());
+				nodes.push_back({ std::string{ segment.name }, segment.index, segment.isIndex, {}, {} });
+			}
+			nodes[current].targets.push_back(static_cast<uint32_t>(i));
+		}
+	}
+
+	NBT_RawTag findRawTag(void* dataPtr, size_t dataSize, std::string_view path) {
+		RawWalker walker{ static_cast<byte*>(dataPtr), dataSize };
+		if (walker.readTagID() != TagID::Compound)
+			throw std::runtime_error("Root tag of NBT data is not a TAG_Compound.");
+		walker.take(walker.read<uint16_t>());
+		return findPath(walker, path);
+	}
+
+	NBT_RawTag findRawEntry(void* compoundPtr, size_t size, std::string_view path) {
+		RawWalker walker{ static_cast<byte*>(compoundPtr), size };
+		return findPath(walker, path);
+	}
+
+	size_t findRawEntries(void* compoundPtr, size_t size, const NBT_RawPathSet& paths, std::span<NBT_RawTag> out) {
+		if (out.size() != paths.size())
+			throw std::invalid_argument("findRawEntries needs one result for every path.");
+		std::fill(out.begin(), out.end(), NBT_RawTag{});
+		RawWalker walker{ static_cast<byte*>(compoundPtr), size };
+		walkPathNode(walker, TagID::Compound, paths.nodes, paths.nodes.front(), out, 1u);
+		return walker.getCursor();
+	}
+
+	size_t rawPayloadSize(const void* dataPtr, size_t size, TagID id) {
+		RawWalker walker{ static_cast<byte*>(const_cast<void*>(dataPtr)), size };
+		walker.skipPayload(id);
+		return walker.getCursor();
+	}
+}
@@ -0,0 +1,126 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <stdexcept>
+
+#include "NBT_Lib.h"
+
+namespace NBT_Lib {
+	//Location of a tag inside an encoded NBT document, found without parsing the document.
+	struct NBT_RawTag {
+		byte* payload{ nullptr }; //Big endian value, for arrays and lists the first element after the header. nullptr if not found.
+		TagID type{ TagID::End };
+		TagID elementType{ TagID::End }; //Type of the values: the tag's own type for numbers, the element type for arrays and lists.
+		size_t count{ 0u }; //Number of values, 1 for numbers.
+
+		explicit operator bool() const {
+			return payload != nullptr;
+		}
+	};
+
+	//Finds the tag at a path such as "Data.Player.Pos[1]" relative to the root compound of an encoded document.
+	//Indices select elements of lists and arrays. Returns an empty NBT_RawTag if the path does not exist.
+	//Names are compared in their encoded MUTF-8 form, which only differs from UTF-8 for NUL and characters outside of the BMP.
+	//Only the part of the document in front of the tag is read, throws std::out_of_range or std::runtime_error if that part is malformed.
+	//Does not allocate any memory.
+	[[nodiscard]]
+	NBT_RawTag findRawTag(void* dataPtr, size_t dataSize, std::string_view path);
+
+	//Like findRawTag, with the path relative to a compound whose payload (its first entry) starts at compoundPtr.
+	//An empty path refers to the compound itself.
+	[[nodiscard]]
+	NBT_RawTag findRawEntry(void* compoundPtr, size_t size, std::string_view path);
+
+	//Several paths relative to a compound, merged into a tree so findRawEntries can resolve all of them in a single pass.
+	//Throws std::invalid_argument if a path contains a malformed index.
+	class NBT_RawPathSet {
+	public:
+		struct Node {
+			std::string name; //Entry name, if this is not an index.
+			size_t index{ 0u };
+			bool isIndex{ false };
+			std::vector<uint32_t> children; //Into nodes.
+			std::vector<uint32_t> targets; //Paths ending at this node.
+		};
+
+		explicit NBT_RawPathSet(std::span<const std::string_view> paths);
+
+		[[nodiscard]]
+		size_t size() const {
+			return pathCount;
+		}
+
+	private:
+		friend size_t findRawEntries(void* compoundPtr, size_t size, const NBT_RawPathSet& paths, std::span<NBT_RawTag> out);
+
+		std::vector<Node> nodes; //nodes[0] is the compound the paths are relative to.
+		size_t pathCount;
+	};
+
+	//Like findRawEntry for every path of the set at once, out[i] receives the tag at path i and has to have one element per path.
+	//Unlike findRawEntry the whole compound is read, returns the size of its payload.
+	size_t findRawEntries(void* compoundPtr, size_t size, const NBT_RawPathSet& paths, std::span<NBT_RawTag> out);
+
+	//Returns the number of bytes occupied by the payload of a tag of the given type starting at dataPtr, without allocating memory.
+	//Throws std::out_of_range or std::runtime_error if the payload is malformed.
+	[[nodiscard]]
+	size_t rawPayloadSize(const void* dataPtr, size_t size, TagID id);
+
+	//Overwrites the value of a number tag, or of a single element of an array or list of numbers, in place.
+	//Throws std::runtime_error if the tag was not found or its type is not T.
+	template<typename T>
+	void patchRawValue(const NBT_RawTag& tag, T value) {
+		if (!tag)
+			throw std::runtime_error("Tag to patch does not exist.");
+		if (tag.elementType != numberTagID<T>() || tag.count != 1u)
+			throw std::runtime_error("Type mismatch, cannot patch a " + TagIDToString(tag.type) + " with a " + TagIDToString(numberTagID<T>()) + " value.");
+		value = byteswap(value);
+		memcpy(tag.payload, &value, sizeof(value));
+	}
+
+	template<typename T>
+	void patchRawValue(void* dataPtr, size_t dataSize, std::string_view path, T value) {
+		patchRawValue(findRawTag(dataPtr, dataSize, path), value);
+	}
+
+	//Overwrites all values of an array, or of a list of numbers, in place. The number of values has to stay the same.
+	//Throws std::runtime_error if the tag was not found, its element type is not T or its length differs.
+	template<typename T>
+	void patchRawArray(const NBT_RawTag& tag, std::span<const T> values) {
+		if (!tag)
+			throw std::runtime_error("Tag to patch does not exist.");
+		if (tag.elementType != numberTagID<T>() || (tag.type != TagID::List && tag.type != TagID::Byte_Array && tag.type != TagID::Int_Array && tag.type != TagID::Long_Array))
+			throw std::runtime_error("Type mismatch, cannot patch a " + TagIDToString(tag.type) + " with " + TagIDToString(numberTagID<T>()) + " values.");
+		if (tag.count != values.size())
+			throw std::runtime_error("Length mismatch, an array can only be patched with the same number of values.");
+
+		byte* dest{ tag.payload };
+		for (T value : values) {
+			value = byteswap(value);
+			memcpy(dest, &value, sizeof(value));
+			dest += sizeof(value);
+		}
+	}
+
+	template<typename T>
+	void patchRawArray(void* dataPtr, size_t dataSize, std::string_view path, std::span<const T> values) {
+		patchRawArray(findRawTag(dataPtr, dataSize, path), values);
+	}
+
+	//Reads a number tag, or a single element of an array or list of numbers, without parsing the document.
+	//Throws std::runtime_error if the tag was not found or its type is not T.
+	template<typename T>
+	[[nodiscard]]
+	T readRawValue(const NBT_RawTag& tag) {
+		if (!tag)
+			throw std::runtime_error("Tag to read does not exist.");
+		if (tag.elementType != numberTagID<T>() || tag.count != 1u)
+			throw std::runtime_error("Type mismatch, cannot read a " + TagIDToString(tag.type) + " as a " + TagIDToString(numberTagID<T>()) + " value.");
+		return copyAndFlipBytes<T>(tag.payload);
+	}
+}
@@ -0,0 +1,375 @@
+#include "NBT_LibRegion.h"
+#include <stdexcept>
+#include <string>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <chrono>
+#include <algorithm>
+
+#include "NBT_LibUtil.h"
+
+namespace NBT_Lib {
+	namespace {
+		//Region files are named r.<regionX>.<regionZ>.mca, the coordinates are needed to find external chunk files.
+		bool parseRegionFileName(const std::filesystem::path& path, int32_t& regionX, int32_t& regionZ) {
+			const std::string fileName{ path.filename().string() };
+			int x, z;
+			char ext[4];
+			if (std::sscanf(fileName.c_str(), "r.%d.%d.%3s", &x, &z, ext) != 3)
+				return false;
+			regionX = x;
+			regionZ = z;
+			return true;
+		}
+
+		std::filesystem::path externalChunkPath(const std::filesystem::path& regionPath, int32_t regionX, int32_t regionZ, size_t chunkIndex) {
+			const int32_t chunkX{ regionX * 32 + static_cast<int32_t>(chunkIndex % 32u) };
+			const int32_t chunkZ{ regionZ * 32 + static_cast<int32_t>(chunkIndex / 32u) };
+			return regionPath.parent_path() / ("c." + std::to_string(chunkX) + "." + std::to_string(chunkZ) + ".mcc");
+		}
+	}
+
+	RegionReader::RegionReader(const std::filesystem::path& path)
+		: RegionReader(loadFileBytes(path), path) {
+	}
+
+	RegionReader::RegionReader(std::vector<byte> data, const std::filesystem::path& path)
+		: filePath{ path }, fileData{ std::move(data) } {
+
+		hasRegionCoords = parseRegionFileName(path, regionX, regionZ);
+		readHeader();
+	}
+
+	void RegionReader::readHeader() {
+		if (fileData.empty())
+			return; //An empty region file contains no chunks.
+		if (fileData.size() < REGION_HEADER_SIZE)
+			throw std::out_of_range("Region file is smaller than the region header: " + filePath.string());
+
+		for (size_t i = 0u; i < REGION_CHUNK_COUNT; ++i) {
+			const uint32_t location{ copyAndFlipBytes<uint32_t>(fileData.data() + i * sizeof(uint32_t)) };
+			locations[i].sectorOffset = location >> 8u;
+			locations[i].sectorCount = static_cast<uint8_t>(location & 0xffu);
+			locations[i].timestamp = copyAndFlipBytes<uint32_t>(fileData.data() + REGION_SECTOR_SIZE + i * sizeof(uint32_t));
+		}
+	}
+
+	bool RegionReader::readChunk(size_t chunkIndex, std::vector<byte>& out, size_t* out_compressedSize) const {
+		const RegionChunkLocation& location{ getLocation(chunkIndex) };
+		if (!location.exists())
+			return false;
+
+		const size_t chunkStart{ size_t(location.sectorOffset) * REGION_SECTOR_SIZE };
+		if (chunkStart + sizeof(int32_t) + sizeof(uint8_t) > fileData.size())
+			throw std::out_of_range("Chunk " + std::to_string(chunkIndex) + " lies outside of region file: " + filePath.string());
+
+		const byte* chunkPtr{ fileData.data() + chunkStart };
+		const int32_t length{ copyAndFlipBytes<int32_t>(const_cast<byte*>(chunkPtr)) }; //Includes the compression byte.
+		if (length < 1 || chunkStart + sizeof(int32_t) + size_t(length) > fileData.size())
+			throw std::out_of_range("Invalid length of chunk " + std::to_string(chunkIndex) + " in region file: " + filePath.string());
+
+		uint8_t compression{ std::to_integer<uint8_t>(chunkPtr[sizeof(int32_t)]) };
+		const byte* payload{ chunkPtr + sizeof(int32_t) + sizeof(uint8_t) };
+		size_t payloadSize{ size_t(length) - 1u };
+
+		std::vector<byte> externalData;
+		if (compression & REGION_EXTERNAL_CHUNK_FLAG) {
+			if (!hasRegionCoords)
+				throw std::runtime_error("Chunk " + std::to_string(chunkIndex) + " is stored externally, but the region coordinates are unknown: " + filePath.string());
+
+			compression &= ~REGION_EXTERNAL_CHUNK_FLAG;
+			externalData = loadFileBytes(externalChunkPath(filePath, regionX, regionZ, chunkIndex));
+			payload = externalData.data();
+			payloadSize = externalData.size();
+		}
+
+		if (out_compressedSize)
+			*out_compressedSize = payloadSize;
+
+		switch (static_cast<ChunkCompression>(compression)) {
+			using enum ChunkCompression;
+		case GZip:
+			decompressData(payload, payloadSize, out, CompressionFormat::GZip);
+			return true;
+		case Zlib:
+			decompressData(payload, payloadSize, out, CompressionFormat::Zlib);
+			return true;
+		case None:
+			out.assign(payload, payload + payloadSize);
+			return true;
+		default:
+			throw std::runtime_error("Unsupported compression type " + std::to_string(compression) + " for chunk " + std::to_string(chunkIndex) + " in region file: " + filePath.string());
+		}
+	}
+
+	namespace {
+		constexpr size_t CHUNK_HEADER_SIZE{ sizeof(int32_t) + sizeof(uint8_t) }; //Length followed by the compression byte.
+		constexpr size_t MAX_CHUNK_SECTORS{ 255u }; //The sector count is stored in a single byte.
+		constexpr size_t MAX_SECTOR_OFFSET{ 0xffffffu }; //The sector offset is stored in 3 bytes.
+
+		template<typename T>
+		void storeBigEndian(byte* dest, T value) {
+			value = byteswap(value);
+			memcpy(dest, &value, sizeof(value));
+		}
+
+		size_t sectorsFor(size_t size) {
+			return (size + REGION_SECTOR_SIZE - 1u) / REGION_SECTOR_SIZE;
+		}
+
+		struct EncodedChunk {
+			std::vector<byte> sectors; //Chunk header and payload, padded to whole sectors.
+			std::vector<byte> external; //Payload of chunks too large for the region file, written to a .mcc file.
+			uint32_t sectorOffset{ 0u };
+		};
+
+		void encodeChunk(const RegionChunkWrite& chunk, const RegionWriteOptions& options, EncodedChunk& out) {
+			const std::vector<byte> nbtData{ buildBinaryNBTFile(chunk.root) };
+
+			std::vector<byte>& sectors{ out.sectors };
+			sectors.resize(CHUNK_HEADER_SIZE);
+			switch (options.compression) {
+				using enum ChunkCompression;
+			case GZip:
+				compressData(nbtData.data(), nbtData.size(), sectors, CompressionFormat::GZip, options.compressionLevel);
+				break;
+			case Zlib:
+				compressData(nbtData.data(), nbtData.size(), sectors, CompressionFormat::Zlib, options.compressionLevel);
+				break;
+			case None:
+				sectors.insert(sectors.end(), nbtData.begin(), nbtData.end());
+				break;
+			default:
+				break; //Rejected before encoding.
+			}
+
+			uint8_t compression{ static_cast<uint8_t>(options.compression) };
+			if (sectorsFor(sectors.size()) > MAX_CHUNK_SECTORS) {
+				out.external.assign(sectors.begin() + CHUNK_HEADER_SIZE, sectors.end());
+				sectors.resize(CHUNK_HEADER_SIZE);
+				compression |= REGION_EXTERNAL_CHUNK_FLAG;
+			}
+			storeBigEndian(sectors.data(), static_cast<int32_t>(sectors.size() - sizeof(int32_t)));
+			sectors[sizeof(int32_t)] = byte{ compression };
+			sectors.resize(sectorsFor(sectors.size()) * REGION_SECTOR_SIZE);
+		}
+
+		void writeRegion(const std::filesystem::path& path, std::span<const RegionChunkWrite> chunks, const RegionWriteOptions& options, bool keepExisting) {
+			if (options.compression != ChunkCompression::GZip && options.compression != ChunkCompression::Zlib && options.compression != ChunkCompression::None)
+				throw std::invalid_argument("Unsupported compression type for writing region files.");
+
+			std::array<bool, REGION_CHUNK_COUNT> rewritten{};
+			for (const RegionChunkWrite& chunk : chunks) {
+				if (chunk.chunkIndex >= REGION_CHUNK_COUNT)
+					throw std::out_of_range("Chunk index " + std::to_string(chunk.chunkIndex) + " is outside of the region.");
+				if (rewritten[chunk.chunkIndex])
+					throw std::invalid_argument("Chunk " + std::to_string(chunk.chunkIndex) + " is written more than once.");
+				rewritten[chunk.chunkIndex] = true;
+			}
+
+			//Only the header of an existing file is read, the data of chunks that are kept is never touched.
+			std::vector<byte> header(REGION_HEADER_SIZE);
+			size_t fileSectors{ 0u };
+			if (keepExisting && std::filesystem::exists(path)) {
+				const uintmax_t fileSize{ std::filesystem::file_size(path) };
+				if (fileSize != 0u) {
+					if (fileSize < REGION_HEADER_SIZE)
+						throw std::out_of_range("Region file is smaller than the region header: " + path.string());
+					std::ifstream filestream(path, std::ios_base::in | std::ios_base::binary);
+					if (!filestream.read(reinterpret_cast<char*>(header.data()), header.size()))
+						throw std::runtime_error("Failed to read region header: " + path.string());
+					fileSectors = sectorsFor(fileSize);
+				}
+			}
+
+			std::vector<EncodedChunk> encoded(chunks.size());
+			parallelFor(chunks.size(), options.threadCount, [&](size_t i, size_t) {
+				if (chunks[i].root)
+					encodeChunk(chunks[i], options, encoded[i]);
+			});
+
+			int32_t regionX{ 0 };
+			int32_t regionZ{ 0 };
+			const bool hasRegionCoords{ parseRegionFileName(path, regionX, regionZ) };
+
+			//Sector allocation: mark everything that stays where it is, then place the remaining chunks first fit.
+			std::vector<bool> usedSectors(std::max(fileSectors, size_t{ 2u }), false);
+			const auto markUsed{ [&](size_t offset, size_t count) {
+				if (offset + count > usedSectors.size())
+					usedSectors.resize(offset + count, false);
+				std::fill_n(usedSectors.begin() + offset, count, true);
+			} };
+			markUsed(0u, REGION_HEADER_SIZE / REGION_SECTOR_SIZE);
+
+			const auto oldLocation{ [&](size_t chunkIndex) {
+				const uint32_t location{ copyAndFlipBytes<uint32_t>(header.data() + chunkIndex * sizeof(uint32_t)) };
+				return std::pair<size_t, size_t>{ location >> 8u, location & 0xffu };
+			} };
+			for (size_t i = 0u; i < REGION_CHUNK_COUNT; ++i) {
+				const auto [offset, count] { oldLocation(i) };
+				if (!rewritten[i] && offset != 0u && count != 0u)
+					markUsed(offset, count);
+			}
+
+			std::vector<size_t> toPlace;
+			for (size_t i = 0u; i < chunks.size(); ++i) {
+				if (!chunks[i].root)
+					continue;
+				const size_t count{ encoded[i].sectors.size() / REGION_SECTOR_SIZE };
+				const auto [oldOffset, oldCount] { oldLocation(chunks[i].chunkIndex) };
+				if (oldOffset >= 2u && count <= oldCount) {
+					encoded[i].sectorOffset = static_cast<uint32_t>(oldOffset);
+					markUsed(oldOffset, count);
+				}
+				else {
+					toPlace.push_back(i);
+				}
+			}
+
+			//Placing large chunks first keeps small chunks from splitting up the gaps they would fit into.
+			//Without an existing file there are no gaps and every chunk is appended, so they are packed in index order instead.
+			if (keepExisting)
+				std::stable_sort(toPlace.begin(), toPlace.end(), [&](size_t a, size_t b) { return encoded[a].sectors.size() > encoded[b].sectors.size(); });
+			else
+				std::sort(toPlace.begin(), toPlace.end(), [&](size_t a, size_t b) { return chunks[a].chunkIndex < chunks[b].chunkIndex; });
+			for (const size_t i : toPlace) {
+				const size_t count{ encoded[i].sectors.size() / REGION_SECTOR_SIZE };
+				size_t offset{ 0u };
+				size_t runLength{ 0u };
+				for (size_t sector = 0u; sector < usedSectors.size() && runLength < count; ++sector) {
+					if (usedSectors[sector])
+						runLength = 0u;
+					else if (runLength++ == 0u)
+						offset = sector;
+				}
+				if (runLength < count) //No gap is large enough, append the chunk (extending a trailing gap).
+					offset = usedSectors.size() - runLength;
+				if (offset > MAX_SECTOR_OFFSET)
+					throw std::runtime_error("Region file exceeds the maximum number of sectors: " + path.string());
+				encoded[i].sectorOffset = static_cast<uint32_t>(offset);
+				markUsed(offset, count);
+			}
+
+			//Update the header.
+			const uint32_t now{ static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count()) };
+			for (size_t i = 0u; i < chunks.size(); ++i) {
+				const size_t chunkIndex{ chunks[i].chunkIndex };
+				uint32_t location{ 0u };
+				uint32_t timestamp{ 0u };
+				if (chunks[i].root) {
+					location = encoded[i].sectorOffset << 8u | static_cast<uint32_t>(encoded[i].sectors.size() / REGION_SECTOR_SIZE);
+					timestamp = chunks[i].timestamp != 0u ? chunks[i].timestamp : now;
+				}
+				storeBigEndian(header.data() + chunkIndex * sizeof(uint32_t), location);
+				storeBigEndian(header.data() + REGION_SECTOR_SIZE + chunkIndex * sizeof(uint32_t), timestamp);
+			}
+
+			//External chunk files are written before the region file refers to them.
+			std::array<bool, REGION_CHUNK_COUNT> storedExternally{};
+			for (size_t i = 0u; i < chunks.size(); ++i) {
+				if (encoded[i].external.empty())
+					continue;
+				if (!hasRegionCoords)
+					throw std::runtime_error("Chunk " + std::to_string(chunks[i].chunkIndex) + " must be stored externally, but the region file name does not contain its coordinates: " + path.string());
+				const std::filesystem::path externalPath{ externalChunkPath(path, regionX, regionZ, chunks[i].chunkIndex) };
+				std::ofstream filestream(externalPath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+				if (!filestream.write(reinterpret_cast<const char*>(encoded[i].external.data()), encoded[i].external.size()))
+					throw std::runtime_error("Failed to write external chunk file: " + externalPath.string());
+				storedExternally[chunks[i].chunkIndex] = true;
+			}
+
+			//Sort the writes by offset and merge adjacent ones, so the chunks of a fresh file are written with a single call.
+			struct SectorWrite {
+				size_t offset;
+				const std::vector<byte>* data;
+			};
+			std::vector<SectorWrite> writes;
+			for (const EncodedChunk& chunk : encoded) {
+				if (!chunk.sectors.empty())
+					writes.push_back({ chunk.sectorOffset, &chunk.sectors });
+			}
+			std::sort(writes.begin(), writes.end(), [](const SectorWrite& a, const SectorWrite& b) { return a.offset < b.offset; });
+
+			//A new file is written next to the old one and renamed over it once complete, so the old file stays intact if writing fails.
+			const std::filesystem::path writePath{ keepExisting ? path : std::filesystem::path{ path.string() + ".tmp" } };
+			try {
+				std::fstream filestream;
+				if (keepExisting && fileSectors != 0u)
+					filestream.open(writePath, std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+				else
+					filestream.open(writePath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+				if (!filestream.is_open())
+					throw std::runtime_error("File could not be opened: " + writePath.string());
+
+				std::vector<byte> run;
+				for (size_t i = 0u; i < writes.size();) {
+					size_t end{ i + 1u };
+					size_t nextOffset{ writes[i].offset + writes[i].data->size() / REGION_SECTOR_SIZE };
+					while (end < writes.size() && writes[end].offset == nextOffset)
+						nextOffset += writes[end++].data->size() / REGION_SECTOR_SIZE;
+
+					const byte* data{ writes[i].data->data() };
+					size_t size{ writes[i].data->size() };
+					if (end - i > 1u) {
+						run.clear();
+						for (size_t j = i; j < end; ++j)
+							run.insert(run.end(), writes[j].data->begin(), writes[j].data->end());
+						data = run.data();
+						size = run.size();
+					}
+					filestream.seekp(static_cast<std::streamoff>(writes[i].offset * REGION_SECTOR_SIZE));
+					if (!filestream.write(reinterpret_cast<const char*>(data), size))
+						throw std::runtime_error("Failed to write region file: " + writePath.string());
+					i = end;
+				}
+
+				//The header goes last, so it never refers to chunk data that has not been written yet.
+				if (!filestream.flush())
+					throw std::runtime_error("Failed to write region file: " + writePath.string());
+				filestream.seekp(0);
+				if (!filestream.write(reinterpret_cast<const char*>(header.data()), header.size()))
+					throw std::runtime_error("Failed to write region header: " + writePath.string());
+				filestream.close();
+				if (filestream.fail())
+					throw std::runtime_error("Failed to write region file: " + writePath.string());
+
+				if (!keepExisting)
+					std::filesystem::rename(writePath, path);
+			}
+			catch (...) {
+				if (!keepExisting) {
+					std::error_code error;
+					std::filesystem::remove(writePath, error);
+				}
+				throw;
+			}
+
+			//External chunk files the region no longer refers to are removed once the header is written. A new file replaces all
+			//previous contents, an update only the rewritten chunks.
+			if (hasRegionCoords) {
+				for (size_t i = 0u; i < REGION_CHUNK_COUNT; ++i) {
+					if (storedExternally[i] || (keepExisting && !rewritten[i]))
+						continue;
+					std::error_code error;
+					std::filesystem::remove(externalChunkPath(path, regionX, regionZ, i), error);
+				}
+			}
+
+			//Drop free sectors at the end of the file, e.g. left behind by a chunk that moved into a gap.
+			size_t lastUsed{ usedSectors.size() };
+			while (lastUsed > 0u && !usedSectors[lastUsed - 1u])
+				--lastUsed;
+			if (keepExisting && lastUsed < fileSectors)
+				std::filesystem::resize_file(path, lastUsed * REGION_SECTOR_SIZE);
+		}
+	}
+
+	void writeRegionFile(const std::filesystem::path& path, std::span<const RegionChunkWrite> chunks, const RegionWriteOptions& options) {
+		writeRegion(path, chunks, options, false);
+	}
+
+	void updateRegionFile(const std::filesystem::path& path, std::span<const RegionChunkWrite> chunks, const RegionWriteOptions& options) {
+		writeRegion(path, chunks, options, true);
+	}
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <span>
+#include <filesystem>
+#include <cstdint>
+
+#include "NBT_Lib.h"
+#include "NBT_LibCompression.h"
+#include "NBT_LibUtil.h"
+
+//https://minecraft.wiki/w/Region_file_format
+
+namespace NBT_Lib {
+	using std::byte;
+
+	constexpr size_t REGION_SECTOR_SIZE{ 4096u };
+	constexpr size_t REGION_CHUNK_COUNT{ 1024u }; //32x32 chunks per region.
+	constexpr size_t REGION_HEADER_SIZE{ 2u * REGION_SECTOR_SIZE }; //Location table followed by timestamp table.
+
+	enum class ChunkCompression : uint8_t {
+		GZip		= 1u,
+		Zlib		= 2u,
+		None		= 3u,
+		LZ4			= 4u,
+		Custom		= 127u
+	};
+	//Set in the compression byte when the chunk data is stored in a separate c.<x>.<z>.mcc file.
+	constexpr uint8_t REGION_EXTERNAL_CHUNK_FLAG{ 128u };
+
+	struct RegionChunkLocation {
+		uint32_t sectorOffset{ 0u }; //In sectors from the start of the file, 0 if the chunk is not present.
+		uint8_t sectorCount{ 0u };
+		uint32_t timestamp{ 0u }; //Last modification time in epoch seconds.
+
+		[[nodiscard]]
+		constexpr bool exists() const {
+			return sectorOffset != 0u && sectorCount != 0u;
+		}
+	};
+
+	//Index of a chunk within its region, chunk coordinates may be either absolute or region local.
+	[[nodiscard]]
+	constexpr size_t regionChunkIndex(int32_t chunkX, int32_t chunkZ) {
+		return static_cast<size_t>(chunkX & 31) + static_cast<size_t>(chunkZ & 31) * 32u;
+	}
+
+	//Reads the chunks of an Anvil (.mca) region file.
+	//The file is loaded into memory once, reading chunks does not modify the reader and may be done from multiple threads.
+	class RegionReader {
+		std::filesystem::path filePath;
+		std::vector<byte> fileData;
+		std::array<RegionChunkLocation, REGION_CHUNK_COUNT> locations{};
+		int32_t regionX{ 0 };
+		int32_t regionZ{ 0 };
+		bool hasRegionCoords{ false };
+
+		void readHeader();
+	public:
+		explicit RegionReader(const std::filesystem::path& path);
+		//path is only used to locate external chunk files and may be empty.
+		RegionReader(std::vector<byte> data, const std::filesystem::path& path);
+
+		[[nodiscard]]
+		const RegionChunkLocation& getLocation(size_t chunkIndex) const {
+			return locations.at(chunkIndex);
+		}
+		[[nodiscard]]
+		bool hasChunk(size_t chunkIndex) const {
+			return getLocation(chunkIndex).exists();
+		}
+		[[nodiscard]]
+		size_t getFileSize() const {
+			return fileData.size();
+		}
+
+		//Decompresses the NBT data of a chunk into out. Returns false if the chunk is not present in the region.
+		//Returns the number of compressed bytes read through out_compressedSize if it is not null.
+		bool readChunk(size_t chunkIndex, std::vector<byte>& out, size_t* out_compressedSize = nullptr) const;
+	};
+
+	struct RegionChunkWrite {
+		size_t chunkIndex{ 0u };
+		const Compound_Tag* root{ nullptr }; //nullptr removes the chunk from the region.
+		uint32_t timestamp{ 0u }; //0 uses the current time.
+	};
+
+	struct RegionWriteOptions {
+		ChunkCompression compression{ ChunkCompression::Zlib }; //GZip, Zlib or None.
+		int compressionLevel{ DEFAULT_COMPRESSION_LEVEL };
+		size_t threadCount{ 0u }; //Threads encoding and compressing chunks, 0 = hardware concurrency.
+	};
+
+	//Writes a region file containing exactly the given chunks, replacing the file if it already exists.
+	//Chunks are encoded and compressed in parallel and packed without gaps in chunk index order. The file is written next to path
+	//as <path>.tmp and renamed over it once complete, then external chunk files of the previous contents are removed.
+	//Chunks larger than 255 sectors are stored in external c.<x>.<z>.mcc files, which requires the file to be named r.<x>.<z>.mca.
+	void writeRegionFile(const std::filesystem::path& path, std::span<const RegionChunkWrite> chunks, const RegionWriteOptions& options = {});
+
+	//Rewrites only the given chunks of a region file, all other chunks are left untouched (the file is created if it does not exist).
+	//A chunk that still fits into its old sectors is written back in place, the others go into the first gap large enough
+	//to hold them, largest first, or are appended. Adjacent sectors are written together and the header is written once, after
+	//all chunk data. External chunk files of rewritten chunks are only removed after that, free sectors at the end of the file are truncated.
+	void updateRegionFile(const std::filesystem::path& path, std::span<const RegionChunkWrite> chunks, const RegionWriteOptions& options = {});
+}
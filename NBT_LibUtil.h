@@ -1,5 +1,19 @@
 #pragma once
 #include <bit>
+#include <cstring>
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <memory_resource>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <exception>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <functional>
 namespace NBT_Lib {
 	using std::byte;
 
@@ -8,7 +22,7 @@ namespace NBT_Lib {
 	inline constexpr valueType byteswap(const valueType val) {
 		valueType flipped;
 		for (size_t i = 0u; i < sizeof(valueType); ++i) {
-			memcpy((&flipped) + i, (&val) + (sizeof(valueType) - 1u - i), 1u);
+			memcpy(reinterpret_cast<byte*>(&flipped) + i, reinterpret_cast<const byte*>(&val) + (sizeof(valueType) - 1u - i), 1u);
 		}
 		return flipped;
 	}
@@ -49,14 +63,50 @@ namespace NBT_Lib {
 		memRes->deallocate(static_cast<objectType*>(ptr), sizeof(objectType), alignof(objectType));
 	}
 
+	//Loads an entire file into memory.
+	[[nodiscard]]
+	inline std::vector<byte> loadFileBytes(const std::filesystem::path& path) {
+		std::ifstream filestream(path, std::ios_base::in | std::ios_base::binary | std::ios_base::ate);
+		if (!filestream.is_open() || filestream.fail())
+			throw std::runtime_error("File could not be opened: " + path.string());
+
+		const size_t fileSize = static_cast<size_t>(filestream.tellg());
+		std::vector<byte> data(fileSize);
+		filestream.seekg(0, std::ios_base::beg);
+		filestream.read(reinterpret_cast<char*>(data.data()), fileSize);
+		if (filestream.fail())
+			throw std::runtime_error("Failed to read file: " + path.string());
+
+		return data;
+	}
+
 	class BinaryStream {
+	public:
+		//Receives the data of a streaming BinaryStream one chunk at a time.
+		using Sink = std::function<void(const byte* data, size_t size)>;
+
+	private:
 		const size_t chunkAllocSize{ 1u << 10u };
 		std::vector<byte*> chunks; //chunk data ptr.
 		size_t cursor = 0u; //number of bytes written to the active chunk.
+		Sink sink; //If set, full chunks are passed to it and reused instead of being kept.
+		std::vector<byte>* target{ nullptr }; //If set, data is appended to it directly instead of being collected in chunks.
 	public:
 		BinaryStream() {
 			chunks.push_back(new byte[chunkAllocSize]);
 		}
+		//Passes the data to sink in chunks of chunkSize bytes as it is added, so only a single chunk is ever held.
+		//Call flush after adding the last data to pass on the rest.
+		explicit BinaryStream(Sink sink, size_t chunkSize = 1u << 16u)
+			: chunkAllocSize{ std::max<size_t>(chunkSize, 1u) }, sink{ std::move(sink) } {
+			chunks.push_back(new byte[chunkAllocSize]);
+		}
+		//Appends the data directly to target, so a buffer kept around between streams stops allocating once it is large enough.
+		explicit BinaryStream(std::vector<byte>& target)
+			: target{ &target } {
+		}
+		BinaryStream(const BinaryStream&) = delete;
+		BinaryStream& operator=(const BinaryStream&) = delete;
 		~BinaryStream() {
 			for (auto& elem : chunks)
 				delete[] elem;
@@ -65,6 +115,10 @@ namespace NBT_Lib {
 		//Add some bytes to the end of the buffer.
 		void pushbackData(const void* data, size_t size) { //TODO test
 			byte* dataPtr{ (byte*)data };
+			if (target) {
+				target->insert(target->end(), dataPtr, dataPtr + size);
+				return;
+			}
 			while (size != 0u) {
 				if (cursor + size < chunkAllocSize) { //if everthing fits in the active chunk.
 					memcpy(chunks.back() + cursor, dataPtr, size);
@@ -77,16 +131,30 @@ namespace NBT_Lib {
 					memcpy(chunks.back() + cursor, dataPtr, copySize);
 					size -= copySize;
 					dataPtr += copySize;
-					//make a new chunk and copy the rest.
 					cursor = 0u;
+					if (sink) { //pass the full chunk on and reuse it.
+						sink(chunks.back(), chunkAllocSize);
+						continue;
+					}
+					//make a new chunk and copy the rest.
 					chunks.push_back(new byte[chunkAllocSize]);
 				}
 			}
 		}
 
+		//Passes the data of the active chunk to the sink of a streaming BinaryStream.
+		void flush() {
+			if (sink && cursor != 0u) {
+				sink(chunks.back(), cursor);
+				cursor = 0u;
+			}
+		}
+
 		//Packs all the data into a single buffer and returns it.
 		[[nodiscard]]
 		std::vector<byte> getData() {
+			if (target)
+				return *target;
 			const size_t totalSize{ (chunks.size() - 1u) * chunkAllocSize + cursor };
 			std::vector<byte> data(totalSize);
 			byte* dataPtr{ data.data() };
@@ -101,4 +169,133 @@ namespace NBT_Lib {
 		}
 	};
 
+
+	//Threads kept alive between parallel loops, for callers running many short ones such as encoding a batch every tick.
+	//The calling thread takes part as worker 0, so a pool of threadCount workers starts threadCount - 1 threads.
+	//Runs one loop at a time, a pool must not be used from several threads at once.
+	class WorkerPool {
+		std::mutex mutex;
+		std::condition_variable wake;
+		std::condition_variable done;
+		const std::function<void(size_t)>* job{ nullptr };
+		uint64_t generation{ 0u };
+		size_t busy{ 0u };
+		bool stopping{ false };
+		std::vector<std::jthread> threads;
+
+		void workerLoop(size_t worker) {
+			uint64_t seenGeneration{ 0u };
+			while (true) {
+				const std::function<void(size_t)>* currentJob;
+				{
+					std::unique_lock lock{ mutex };
+					wake.wait(lock, [&]() { return stopping || generation != seenGeneration; });
+					if (stopping)
+						return;
+					seenGeneration = generation;
+					currentJob = job;
+				}
+				(*currentJob)(worker);
+				std::scoped_lock lock{ mutex };
+				if (--busy == 0u)
+					done.notify_one();
+			}
+		}
+
+	public:
+		//0 = hardware concurrency.
+		explicit WorkerPool(size_t threadCount) {
+			if (threadCount == 0u)
+				threadCount = std::max(1u, std::thread::hardware_concurrency());
+			threads.reserve(threadCount - 1u);
+			for (size_t worker = 1u; worker < threadCount; ++worker)
+				threads.emplace_back([this, worker]() { workerLoop(worker); });
+		}
+		WorkerPool(const WorkerPool&) = delete;
+		WorkerPool& operator=(const WorkerPool&) = delete;
+		~WorkerPool() {
+			{
+				std::scoped_lock lock{ mutex };
+				stopping = true;
+			}
+			wake.notify_all();
+			threads.clear(); //jthreads join here.
+		}
+
+		[[nodiscard]]
+		size_t size() const {
+			return threads.size() + 1u;
+		}
+
+		//Calls newJob(workerIndex) once on every worker and returns once all of them have returned. newJob must not throw.
+		void run(const std::function<void(size_t)>& newJob) {
+			{
+				std::scoped_lock lock{ mutex };
+				job = &newJob;
+				busy = threads.size();
+				++generation;
+			}
+			wake.notify_all();
+			newJob(0u);
+			std::unique_lock lock{ mutex };
+			done.wait(lock, [&]() { return busy == 0u; });
+		}
+	};
+
+	//Calls func(index, workerIndex) for every index in [0, count) on the workers of pool.
+	//workerIndex is in [0, pool.size()) and can be used to address per-worker state such as a memory arena.
+	//If func throws, the remaining indices are skipped and the first exception is rethrown on the calling thread.
+	template<typename Func>
+	void parallelFor(WorkerPool& pool, size_t count, Func&& func) {
+		if (pool.size() <= 1u || count <= 1u) {
+			for (size_t i = 0u; i < count; ++i)
+				func(i, size_t{ 0u });
+			return;
+		}
+
+		std::atomic<size_t> nextIndex{ 0u };
+		std::atomic<bool> failed{ false };
+		std::exception_ptr firstError;
+		std::mutex errorMutex;
+		pool.run([&](size_t worker) {
+			while (!failed.load(std::memory_order_relaxed)) {
+				const size_t i{ nextIndex.fetch_add(1u, std::memory_order_relaxed) };
+				if (i >= count)
+					break;
+				try {
+					func(i, worker);
+				}
+				catch (...) {
+					std::scoped_lock lock{ errorMutex };
+					if (!firstError)
+						firstError = std::current_exception();
+					failed.store(true, std::memory_order_relaxed);
+				}
+			}
+		});
+
+		if (firstError)
+			std::rethrow_exception(firstError);
+	}
+
+	//Calls func(index, workerIndex) for every index in [0, count) using up to threadCount threads (0 = hardware concurrency).
+	//The threads only live for this call, callers running loops repeatedly should keep a WorkerPool instead.
+	//workerIndex is in [0, threadCount) and can be used to address per-worker state such as a memory arena.
+	//If func throws, the remaining indices are skipped and the first exception is rethrown on the calling thread.
+	template<typename Func>
+	void parallelFor(size_t count, size_t threadCount, Func&& func) {
+		if (threadCount == 0u)
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+		threadCount = std::min(threadCount, count);
+
+		if (threadCount <= 1u) {
+			for (size_t i = 0u; i < count; ++i)
+				func(i, size_t{ 0u });
+			return;
+		}
+
+		WorkerPool pool{ threadCount };
+		parallelFor(pool, count, std::forward<Func>(func));
+	}
+
 }
@@ -0,0 +1,274 @@
+#include "NBT_LibValidate.h"
+#include <array>
+
+namespace NBT_Lib {
+	namespace {
+		//Bytes allocated for a pmr::string of the given length, strings fitting the small string buffer allocate nothing.
+		size_t stringAllocationSize(size_t length) {
+			static const size_t smallStringCapacity{ std::pmr::string{}.capacity() };
+			return length > smallStringCapacity ? length + 1u : 0u;
+		}
+
+		//Estimated size of one entry of Compound_Tag::indexMap: node with next pointer, key/value pair and cached hash.
+		size_t indexEntryAllocationSize(size_t nameLength) {
+			return sizeof(void*) + sizeof(std::pair<const std::pmr::string, size_t>) + sizeof(size_t) + stringAllocationSize(nameLength);
+		}
+
+		size_t tagObjectSize(TagID id) {
+			switch (id) {
+				using enum TagID;
+			case Byte:
+				return sizeof(Byte_Tag);
+			case Short:
+				return sizeof(Short_Tag);
+			case Int:
+				return sizeof(Int_Tag);
+			case Long:
+				return sizeof(Long_Tag);
+			case Float:
+				return sizeof(Float_Tag);
+			case Double:
+				return sizeof(Double_Tag);
+			case Byte_Array:
+				return sizeof(ByteArray_Tag);
+			case String:
+				return sizeof(String_Tag);
+			case List:
+				return sizeof(List_Tag);
+			case Compound:
+				return sizeof(Compound_Tag);
+			case Int_Array:
+				return sizeof(IntArray_Tag);
+			case Long_Array:
+				return sizeof(LongArray_Tag);
+			default:
+				return sizeof(End_Tag);
+			}
+		}
+
+		struct ValidationFrame {
+			bool isList;
+			TagID listType;
+			uint32_t remaining; //Elements left to read for lists, number of entries read so far for compounds.
+			size_t indexBytes; //Estimated indexMap allocations of a compound's entries.
+		};
+
+		class Validator {
+			const byte* data;
+			size_t size;
+			size_t cursor{ 0u };
+			const NBT_Limits& limits;
+			size_t maxDepth;
+			NBT_ValidationResult result;
+
+			std::array<ValidationFrame, NBT_MAX_DEPTH> stack;
+			size_t depth{ 0u };
+
+			bool fail(const char* error) {
+				result.valid = false;
+				result.error = error;
+				result.errorOffset = cursor;
+				return false;
+			}
+
+			bool addMemory(size_t bytes) {
+				result.requiredMemory += bytes;
+				if (result.requiredMemory > limits.maxMemory)
+					return fail("Document exceeds the memory limit.");
+				return true;
+			}
+
+			bool has(size_t bytes) const {
+				return size - cursor >= bytes;
+			}
+
+			//Names and string values are decoded by the parser, which rejects malformed MUTF-8.
+			bool skipMUTF8(size_t length) {
+				bool needsConversion;
+				if (scanMUTF8(reinterpret_cast<const char*>(data + cursor), length, needsConversion) == SIZE_MAX)
+					return fail("Invalid Modified UTF-8 in a string.");
+				cursor += length;
+				return true;
+			}
+
+			template<typename T>
+			T read() {
+				T value{ copyAndFlipBytes<T>(const_cast<byte*>(data + cursor)) };
+				cursor += sizeof(T);
+				return value;
+			}
+
+			bool push(bool isList, TagID listType, uint32_t remaining) {
+				if (depth >= maxDepth)
+					return fail("Document exceeds the maximum nesting depth.");
+				stack[depth++] = { isList, listType, remaining, 0u };
+				if (depth > result.depth)
+					result.depth = depth;
+				return true;
+			}
+
+			template<typename valueType>
+			bool readArray() {
+				if (!has(sizeof(int32_t)))
+					return fail("Data ran out while reading the length of an array.");
+				const int32_t count{ read<int32_t>() };
+				if (count < 0)
+					return fail("Negative array length.");
+				if (size_t(count) > limits.maxArrayLength)
+					return fail("Array exceeds the maximum array length.");
+				if (!has(size_t(count) * sizeof(valueType)))
+					return fail("Data ran out while reading the values of an array.");
+				cursor += size_t(count) * sizeof(valueType);
+				return addMemory(size_t(count) * sizeof(valueType));
+			}
+
+			//Validates the payload of a tag, nested compounds and lists are pushed onto the stack instead of being recursed into.
+			bool readPayload(TagID id) {
+				if (++result.tagCount > limits.maxTags)
+					return fail("Document exceeds the maximum number of tags.");
+				if (!addMemory(tagObjectSize(id)))
+					return false;
+
+				switch (id) {
+					using enum TagID;
+				case Byte:
+				case Short:
+				case Int:
+				case Long:
+				case Float:
+				case Double:
+					if (!has(minimumPayloadSize(id)))
+						return fail("Data ran out while reading a number.");
+					cursor += minimumPayloadSize(id);
+					return true;
+				case Byte_Array:
+					return readArray<int8_t>();
+				case Int_Array:
+					return readArray<int32_t>();
+				case Long_Array:
+					return readArray<int64_t>();
+				case String: {
+					if (!has(sizeof(uint16_t)))
+						return fail("Data ran out while reading the length of a string.");
+					const size_t length{ read<uint16_t>() };
+					if (length > limits.maxStringLength)
+						return fail("String exceeds the maximum string length.");
+					if (!has(length))
+						return fail("Data ran out while reading the characters of a string.");
+					if (!skipMUTF8(length))
+						return false;
+					return addMemory(stringAllocationSize(length));
+				}
+				case List: {
+					if (!has(sizeof(int8_t) + sizeof(int32_t)))
+						return fail("Data ran out while reading the header of a list.");
+					const TagID listType{ static_cast<TagID>(read<uint8_t>()) };
+					const int32_t count{ read<int32_t>() };
+					if (listType > TagID::Long_Array)
+						return fail("Invalid element type of a list.");
+					if (count < 0)
+						return fail("Negative list length.");
+					if (listType == TagID::End && count != 0)
+						return fail("List with elements of type TAG_End.");
+					if (size_t(count) > limits.maxListLength)
+						return fail("List exceeds the maximum list length.");
+					if ((size - cursor) / std::max<size_t>(minimumPayloadSize(listType), 1u) < size_t(count))
+						return fail("Data ran out while reading the elements of a list.");
+					if (!addMemory(size_t(count) * sizeof(NBT_TagBase*)))
+						return false;
+					return push(true, listType, static_cast<uint32_t>(count));
+				}
+				case Compound:
+					return push(false, TagID::End, 0u);
+				default:
+					return fail("Invalid tag id.");
+				}
+			}
+
+			bool readCompoundEntry(ValidationFrame& frame) {
+				if (!has(sizeof(int8_t)))
+					return fail("Data ran out while reading the tag id of a compound entry.");
+				const TagID id{ static_cast<TagID>(read<uint8_t>()) };
+
+				if (id == TagID::End) {
+					//The entries of a compound are held in a vector and indexMap, which has roughly one bucket per entry.
+					if (frame.remaining != 0u && !addMemory(frame.remaining * (sizeof(NBT_TagBase*) + sizeof(void*)) + frame.indexBytes))
+						return false;
+					--depth;
+					return true;
+				}
+				if (id > TagID::Long_Array)
+					return fail("Invalid tag id.");
+
+				if (!has(sizeof(uint16_t)))
+					return fail("Data ran out while reading the name length of a compound entry.");
+				const size_t nameLength{ read<uint16_t>() };
+				if (!has(nameLength))
+					return fail("Data ran out while reading the name of a compound entry.");
+				if (!skipMUTF8(nameLength))
+					return false;
+
+				++frame.remaining;
+				frame.indexBytes += indexEntryAllocationSize(nameLength);
+				if (!addMemory(stringAllocationSize(nameLength)))
+					return false;
+				return readPayload(id);
+			}
+
+		public:
+			Validator(const byte* data, size_t size, const NBT_Limits& limits)
+				: data{ data }, size{ size }, limits{ limits }, maxDepth{ std::min(limits.maxDepth, NBT_MAX_DEPTH) } {
+			}
+
+			NBT_ValidationResult run() {
+				if (!has(sizeof(int8_t) + sizeof(uint16_t))) {
+					fail("Data ran out while reading the header of the root tag.");
+					return result;
+				}
+				if (static_cast<TagID>(read<uint8_t>()) != TagID::Compound) {
+					cursor = 0u;
+					fail("Root tag must be TAG_Compound.");
+					return result;
+				}
+				const size_t nameLength{ read<uint16_t>() };
+				if (!has(nameLength)) {
+					fail("Data ran out while reading the name of the root tag.");
+					return result;
+				}
+				cursor += nameLength;
+
+				//The root compound itself is returned by value and not allocated from the memory resource.
+				++result.tagCount;
+				if (!push(false, TagID::End, 0u))
+					return result;
+
+				while (depth != 0u) {
+					ValidationFrame& frame{ stack[depth - 1u] };
+					bool ok;
+					if (frame.isList) {
+						if (frame.remaining == 0u) {
+							--depth;
+							continue;
+						}
+						--frame.remaining;
+						ok = readPayload(frame.listType);
+					}
+					else {
+						ok = readCompoundEntry(frame);
+					}
+					if (!ok)
+						return result;
+				}
+
+				result.valid = true;
+				result.documentSize = cursor;
+				return result;
+			}
+		};
+	}
+
+	NBT_ValidationResult validateNBT(const void* dataPtr, size_t dataSize, const NBT_Limits& limits) {
+		Validator validator{ static_cast<const byte*>(dataPtr), dataSize, limits };
+		return validator.run();
+	}
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+#include "NBT_Lib.h"
+
+namespace NBT_Lib {
+	//Limits applied by validateNBT, intended for data received from untrusted sources.
+	struct NBT_Limits {
+		size_t maxDepth{ NBT_MAX_DEPTH }; //Nesting depth of compounds and lists, the root compound has depth 1. Clamped to NBT_MAX_DEPTH.
+		size_t maxTags{ SIZE_MAX }; //Total number of tags, including list elements.
+		size_t maxArrayLength{ SIZE_MAX }; //Number of elements of a single Byte/Int/Long array.
+		size_t maxListLength{ SIZE_MAX }; //Number of elements of a single list.
+		size_t maxStringLength{ UINT16_MAX }; //Encoded length of a single string value.
+		size_t maxMemory{ SIZE_MAX }; //Memory that parsing the document would allocate, see NBT_ValidationResult::requiredMemory.
+	};
+
+	struct NBT_ValidationResult {
+		bool valid{ false };
+		const char* error{ nullptr }; //Static description of the first problem found, null if valid.
+		size_t errorOffset{ 0u }; //Byte offset into the buffer where the problem was found.
+
+		size_t documentSize{ 0u }; //Bytes used by the document, which may be less than the size of the buffer.
+		size_t tagCount{ 0u };
+		size_t depth{ 0u }; //Deepest nesting encountered.
+		//Memory parseNBT allocates from its memory resource for the resulting tree: tag objects, names and
+		//string values that do not fit the small string buffer, arrays, list and compound child vectors.
+		//The nodes and buckets of Compound_Tag::indexMap depend on the standard library and are an estimate.
+		size_t requiredMemory{ 0u };
+
+		explicit operator bool() const {
+			return valid;
+		}
+	};
+
+	//Checks that the buffer holds a complete, well formed NBT document with a root TAG_Compound within the given limits.
+	//Does not allocate any memory, so it can be run on untrusted data before deciding whether, and with how much memory, to parse it.
+	[[nodiscard]]
+	NBT_ValidationResult validateNBT(const void* dataPtr, size_t dataSize, const NBT_Limits& limits = {});
+}
@@ -0,0 +1,96 @@
+#include "NBT_LibWriter.h"
+
+namespace NBT_Lib {
+	namespace {
+		//Smallest sink buffer, it has to hold the largest value written without splitting it.
+		constexpr size_t MIN_BUFFER_SIZE{ 64u };
+	}
+
+	NBT_Writer::NBT_Writer(std::vector<byte>& out)
+		: out{ &out }, startOffset{ out.size() }, cursor{ out.data() + out.size() }, limit{ cursor } {
+		frames.reserve(16u);
+	}
+
+	NBT_Writer::NBT_Writer(Sink sink, size_t bufferSize)
+		: out{ &buffer }, buffer(std::max(bufferSize, MIN_BUFFER_SIZE)), sink{ std::move(sink) }, startOffset{ 0u }
+		, cursor{ buffer.data() }, limit{ buffer.data() + buffer.size() } {
+		frames.reserve(16u);
+	}
+
+	NBT_Writer::~NBT_Writer() {
+		if (!sink)
+			out->resize(size_t(cursor - out->data()));
+	}
+
+	void NBT_Writer::grow(size_t size) {
+		const size_t used{ size_t(cursor - out->data()) };
+		if (sink) {
+			//Blocks are passed on whole, values larger than the buffer are split by the callers.
+			if (used != 0u)
+				sink(out->data(), used);
+			flushedBytes += used;
+			cursor = out->data();
+			return;
+		}
+
+		out->resize(std::max({ used + size, used * 2u, size_t{ 256u } }));
+		cursor = out->data() + used;
+		limit = out->data() + out->size();
+	}
+
+	void NBT_Writer::finish() {
+#if NBT_LIB_WRITER_CHECKS
+		if (!frames.empty())
+			throw std::runtime_error("NBT_Writer: Finished with " + std::to_string(frames.size()) + " compounds or lists that have not been ended.");
+#endif
+		const size_t used{ size_t(cursor - out->data()) };
+		if (sink) {
+			if (used != 0u)
+				sink(out->data(), used);
+			flushedBytes += used;
+			cursor = out->data();
+			return;
+		}
+
+		out->resize(used);
+		cursor = out->data() + used;
+		limit = cursor;
+	}
+
+	void NBT_Writer::writeMUTF8(std::string_view str) {
+		bool needsConversion;
+		const size_t length{ scanUTF8(str.data(), str.size(), needsConversion) };
+		if (length > UINT16_MAX)
+			throw std::runtime_error("String is too long to be encoded, its Modified UTF-8 form has " + std::to_string(length) + " bytes, at most 65535 are allowed.");
+
+		putValue(static_cast<uint16_t>(length));
+		if (!needsConversion) {
+			writeBytes(str.data(), str.size());
+			return;
+		}
+
+		thread_local std::string converted;
+		converted.resize(length);
+		convertUTF8ToMUTF8(str.data(), str.size(), converted.data());
+		writeBytes(converted.data(), converted.size());
+	}
+
+	void NBT_Writer::structureError(TagID type, bool named) const {
+		if (type == TagID::End) {
+			if (frames.empty())
+				throw std::runtime_error("NBT_Writer: end called without a compound or list to end.");
+			throw std::runtime_error("NBT_Writer: TAG_List ended with " + std::to_string(frames.back().remaining) + " of its elements missing.");
+		}
+		if (frames.empty())
+			throw std::runtime_error("NBT_Writer: " + TagIDToString(type) + " written at the top level, only a named TAG_Compound can begin a document.");
+
+		const Frame& frame{ frames.back() };
+		if (frame.type == TagID::Compound)
+			throw std::runtime_error("NBT_Writer: " + TagIDToString(type) + " written without a name inside a TAG_Compound.");
+		if (named)
+			throw std::runtime_error("NBT_Writer: " + TagIDToString(type) + " written with a name inside a TAG_List.");
+		if (frame.elementType != type)
+			throw std::runtime_error("NBT_Writer: " + TagIDToString(type) + " written to a TAG_List of " + TagIDToString(frame.elementType) + '.');
+		throw std::runtime_error("NBT_Writer: More elements written to a TAG_List than its length.");
+	}
+}
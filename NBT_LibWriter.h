@@ -0,0 +1,292 @@
+#pragma once
+#include <vector>
+#include <span>
+#include <string_view>
+#include <functional>
+
+#include "NBT_Lib.h"
+
+//Structure checks of NBT_Writer, on by default in debug builds. Define NBT_LIB_WRITER_CHECKS as 0 or 1 to override this.
+#ifndef NBT_LIB_WRITER_CHECKS
+#ifdef NDEBUG
+#define NBT_LIB_WRITER_CHECKS 0
+#else
+#define NBT_LIB_WRITER_CHECKS 1
+#endif
+#endif
+
+namespace NBT_Lib {
+	//Encodes an NBT document directly from calls describing it, without building a tree of tags first:
+	//	writer.beginCompound("");
+	//	writer.writeInt("DataVersion", 3700);
+	//	writer.beginList("Pos", TagID::Double, 3u);
+	//	writer.writeDouble(x);
+	//	writer.writeDouble(y);
+	//	writer.writeDouble(z);
+	//	writer.end();
+	//	writer.end();
+	//	writer.finish();
+	//Entries of a compound are written with the functions taking a name, elements of a list with the ones without a name.
+	//With NBT_LIB_WRITER_CHECKS, calls that do not fit the structure, like a list element of the wrong type, too many or too few
+	//elements or an unbalanced end, throw std::runtime_error. Without the checks such calls produce malformed data.
+	//Several root compounds written one after another produce concatenated documents.
+	class NBT_Writer {
+	public:
+		//Receives the encoded data in blocks of at most the buffer size.
+		using Sink = std::function<void(const byte* data, size_t size)>;
+		static constexpr size_t DEFAULT_BUFFER_SIZE{ 1u << 16u };
+
+	private:
+		struct Frame {
+			TagID type; //Compound or List.
+			TagID elementType;
+			size_t remaining; //Elements of a list that are still to be written, only counted with NBT_LIB_WRITER_CHECKS.
+		};
+
+		std::vector<byte>* out;
+		std::vector<byte> buffer; //Only used with a sink.
+		Sink sink;
+		size_t startOffset; //Size of out before the writer appended to it.
+		uint64_t flushedBytes{ 0u };
+		byte* cursor;
+		byte* limit;
+		std::vector<Frame> frames;
+
+		void grow(size_t size);
+		void writeMUTF8(std::string_view str);
+		[[noreturn]]
+		void structureError(TagID type, bool named) const;
+
+		void ensure(size_t size) {
+			if (size_t(limit - cursor) < size)
+				grow(size);
+		}
+
+		template<typename valueType>
+		void putValue(valueType value) {
+			ensure(sizeof(valueType));
+			const valueType flipped{ byteswap(value) };
+			memcpy(cursor, &flipped, sizeof(flipped));
+			cursor += sizeof(flipped);
+		}
+
+		void writeBytes(const void* data, size_t size) {
+			const byte* dataPtr{ static_cast<const byte*>(data) };
+			while (size > size_t(limit - cursor)) {
+				const size_t part{ size_t(limit - cursor) };
+				if (part != 0u) {
+					memcpy(cursor, dataPtr, part);
+					cursor += part;
+					dataPtr += part;
+					size -= part;
+				}
+				grow(size);
+			}
+			if (size != 0u) {
+				memcpy(cursor, dataPtr, size);
+				cursor += size;
+			}
+		}
+
+		void writeHeader(TagID type, std::string_view name) {
+#if NBT_LIB_WRITER_CHECKS
+			if (frames.empty() ? type != TagID::Compound : frames.back().type != TagID::Compound)
+				structureError(type, true);
+#endif
+			ensure(1u);
+			*cursor++ = static_cast<byte>(type);
+			writeMUTF8(name);
+		}
+
+		void beginElement(TagID type) {
+#if NBT_LIB_WRITER_CHECKS
+			if (frames.empty() || frames.back().type != TagID::List || frames.back().elementType != type || frames.back().remaining == 0u)
+				structureError(type, false);
+			--frames.back().remaining;
+#endif
+		}
+
+		void writeCount(size_t count, TagID type) {
+			if (count > size_t(INT32_MAX))
+				throw std::runtime_error(TagIDToString(type) + " is too long to be encoded, it has " + std::to_string(count) + " elements.");
+			putValue(static_cast<int32_t>(count));
+		}
+
+		template<typename valueType>
+		void writeArrayPayload(std::span<const valueType> values, TagID type) {
+			writeCount(values.size(), type);
+			if constexpr (sizeof(valueType) == 1u) {
+				writeBytes(values.data(), values.size());
+			}
+			else {
+				const valueType* valuePtr{ values.data() };
+				size_t count{ values.size() };
+				while (count != 0u) {
+					if (size_t(limit - cursor) < sizeof(valueType))
+						grow(count * sizeof(valueType));
+					const size_t blockCount{ std::min(count, size_t(limit - cursor) / sizeof(valueType)) };
+					for (size_t i = 0u; i < blockCount; ++i) {
+						const valueType flipped{ byteswap(valuePtr[i]) };
+						memcpy(cursor + i * sizeof(valueType), &flipped, sizeof(flipped));
+					}
+					cursor += blockCount * sizeof(valueType);
+					valuePtr += blockCount;
+					count -= blockCount;
+				}
+			}
+		}
+
+		void pushList(TagID elementType, size_t count) {
+#if NBT_LIB_WRITER_CHECKS
+			if (elementType > TagID::Long_Array || (elementType == TagID::End && count != 0u))
+				throw std::runtime_error("NBT_Writer: Invalid element type of TAG_List: " + TagIDToString(elementType));
+#endif
+			ensure(1u);
+			*cursor++ = static_cast<byte>(elementType);
+			writeCount(count, TagID::List);
+			frames.push_back({ TagID::List, elementType, count });
+		}
+
+	public:
+		//Appends the encoded data to out. out holds exactly the written data once finish is called or the writer is destroyed,
+		//until then it may contain unused bytes after it.
+		explicit NBT_Writer(std::vector<byte>& out);
+		//Collects the encoded data in a buffer of bufferSize bytes and passes it to sink whenever the buffer is full and on finish.
+		explicit NBT_Writer(Sink sink, size_t bufferSize = DEFAULT_BUFFER_SIZE);
+		NBT_Writer(const NBT_Writer&) = delete;
+		NBT_Writer& operator=(const NBT_Writer&) = delete;
+		~NBT_Writer();
+
+		//Trims out to the written data, or passes the buffered data to the sink.
+		//With NBT_LIB_WRITER_CHECKS throws std::runtime_error if a compound or list has not been ended.
+		void finish();
+
+		//Bytes written so far, including those still buffered.
+		[[nodiscard]]
+		uint64_t getBytesWritten() const {
+			return flushedBytes + uint64_t(cursor - out->data()) - startOffset;
+		}
+		//Number of compounds and lists that have been begun but not ended.
+		[[nodiscard]]
+		size_t getDepth() const {
+			return frames.size();
+		}
+
+		//Begins a compound entry, or the root compound of a document at the top level.
+		void beginCompound(std::string_view name) {
+			writeHeader(TagID::Compound, name);
+			frames.push_back({ TagID::Compound, TagID::End, 0u });
+		}
+		void beginCompound() {
+			beginElement(TagID::Compound);
+			frames.push_back({ TagID::Compound, TagID::End, 0u });
+		}
+		//Begins a list, exactly count elements of elementType must follow before end is called.
+		void beginList(std::string_view name, TagID elementType, size_t count) {
+			writeHeader(TagID::List, name);
+			pushList(elementType, count);
+		}
+		void beginList(TagID elementType, size_t count) {
+			beginElement(TagID::List);
+			pushList(elementType, count);
+		}
+		//Ends the innermost compound or list. Throws std::runtime_error if there is none, even without NBT_LIB_WRITER_CHECKS.
+		void end() {
+			if (frames.empty())
+				structureError(TagID::End, false);
+#if NBT_LIB_WRITER_CHECKS
+			if (frames.back().remaining != 0u)
+				structureError(TagID::End, false);
+#endif
+			if (frames.back().type == TagID::Compound) {
+				ensure(1u);
+				*cursor++ = static_cast<byte>(TagID::End);
+			}
+			frames.pop_back();
+		}
+
+		void writeByte(std::string_view name, int8_t value) {
+			writeHeader(TagID::Byte, name);
+			putValue(value);
+		}
+		void writeByte(int8_t value) {
+			beginElement(TagID::Byte);
+			putValue(value);
+		}
+		void writeShort(std::string_view name, int16_t value) {
+			writeHeader(TagID::Short, name);
+			putValue(value);
+		}
+		void writeShort(int16_t value) {
+			beginElement(TagID::Short);
+			putValue(value);
+		}
+		void writeInt(std::string_view name, int32_t value) {
+			writeHeader(TagID::Int, name);
+			putValue(value);
+		}
+		void writeInt(int32_t value) {
+			beginElement(TagID::Int);
+			putValue(value);
+		}
+		void writeLong(std::string_view name, int64_t value) {
+			writeHeader(TagID::Long, name);
+			putValue(value);
+		}
+		void writeLong(int64_t value) {
+			beginElement(TagID::Long);
+			putValue(value);
+		}
+		void writeFloat(std::string_view name, float value) {
+			writeHeader(TagID::Float, name);
+			putValue(value);
+		}
+		void writeFloat(float value) {
+			beginElement(TagID::Float);
+			putValue(value);
+		}
+		void writeDouble(std::string_view name, double value) {
+			writeHeader(TagID::Double, name);
+			putValue(value);
+		}
+		void writeDouble(double value) {
+			beginElement(TagID::Double);
+			putValue(value);
+		}
+
+		//Strings are UTF-8 and are converted to Modified UTF-8, throws std::runtime_error if the result is longer than 65535 bytes.
+		void writeString(std::string_view name, std::string_view value) {
+			writeHeader(TagID::String, name);
+			writeMUTF8(value);
+		}
+		void writeString(std::string_view value) {
+			beginElement(TagID::String);
+			writeMUTF8(value);
+		}
+
+		void writeByteArray(std::string_view name, std::span<const int8_t> values) {
+			writeHeader(TagID::Byte_Array, name);
+			writeArrayPayload(values, TagID::Byte_Array);
+		}
+		void writeByteArray(std::span<const int8_t> values) {
+			beginElement(TagID::Byte_Array);
+			writeArrayPayload(values, TagID::Byte_Array);
+		}
+		void writeIntArray(std::string_view name, std::span<const int32_t> values) {
+			writeHeader(TagID::Int_Array, name);
+			writeArrayPayload(values, TagID::Int_Array);
+		}
+		void writeIntArray(std::span<const int32_t> values) {
+			beginElement(TagID::Int_Array);
+			writeArrayPayload(values, TagID::Int_Array);
+		}
+		void writeLongArray(std::string_view name, std::span<const int64_t> values) {
+			writeHeader(TagID::Long_Array, name);
+			writeArrayPayload(values, TagID::Long_Array);
+		}
+		void writeLongArray(std::span<const int64_t> values) {
+			beginElement(TagID::Long_Array);
+			writeArrayPayload(values, TagID::Long_Array);
+		}
+	};
+}
@@ -0,0 +1,613 @@
+//Command line tool that scans a Minecraft world directory using NBT_Lib.
+//Walks every region (*.mca) and NBT (*.dat) file below the world directory, including level.dat,
+//playerdata and the dimension folders, and processes the documents on a thread pool.
+//Each worker owns a memory arena that is released after every document.
+//
+//Usage: NBT_WorldScan <worldDir> <operation> [arguments] [-j threads] [-o output.csv]
+//	stats						Count the tags and encoded bytes of every tag type.
+//	find --key <name>			Print the path of every tag with the given name.
+//	find --value <value>		Print the path of every string or number tag with the given value.
+//	extract <path>...			Write the values at the given paths to CSV, one row per document. e.g. Data.Player.Pos[1]
+//	validate					Validate the structure of every document, parse it and check that encoding it again reproduces the input.
+//
+//Requires linking against NBT_Lib.cpp, NBT_LibCompression.cpp, NBT_LibRegion.cpp, NBT_LibValidate.cpp and zlib.
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <vector>
+#include <array>
+#include <chrono>
+#include <charconv>
+#include <optional>
+#include <memory_resource>
+
+#include "NBT_Lib.h"
+#include "NBT_LibCompression.h"
+#include "NBT_LibRegion.h"
+#include "NBT_LibValidate.h"
+
+namespace fs = std::filesystem;
+using namespace NBT_Lib;
+
+enum class Operation {
+	Stats,
+	Find,
+	Extract,
+	Validate
+};
+
+//Value searched for by find --value, parsed once into every type it can be compared against.
+struct ValueQuery {
+	std::string text;
+	std::optional<int64_t> integer;
+	std::optional<float> singlePrecision;
+	std::optional<double> doublePrecision;
+	std::optional<std::vector<int64_t>> elements;
+};
+
+struct ScanOptions {
+	fs::path worldDir;
+	Operation operation{ Operation::Stats };
+	std::string findKey;
+	ValueQuery findValue;
+	std::vector<std::string> extractPaths;
+	fs::path outputPath;
+	size_t threadCount{ 0u };
+};
+
+struct WorkItem {
+	fs::path path;
+	bool isRegion;
+	uintmax_t fileSize;
+};
+
+constexpr size_t TAG_TYPE_COUNT{ static_cast<size_t>(TagID::Long_Array) + 1u };
+
+using Clock = std::chrono::steady_clock;
+
+//State owned by a single worker thread, merged once all workers are done.
+struct WorkerState {
+	std::pmr::monotonic_buffer_resource arena{ 1u << 20u };
+	std::vector<byte> fileBuffer;
+	std::vector<byte> documentBuffer;
+
+	std::array<uint64_t, TAG_TYPE_COUNT> tagCounts{};
+	std::array<uint64_t, TAG_TYPE_COUNT> tagBytes{};
+	std::vector<std::string> outputLines;
+
+	uint64_t files{ 0u };
+	uint64_t documents{ 0u };
+	uint64_t failures{ 0u };
+	uint64_t compressedBytes{ 0u };
+	uint64_t decodedBytes{ 0u };
+
+	Clock::duration readTime{};
+	Clock::duration decompressTime{};
+	Clock::duration parseTime{};
+	Clock::duration operationTime{};
+};
+
+//Length of a string once encoded as MUTF-8.
+size_t encodedLength(std::string_view str) {
+	bool needsConversion{ false };
+	return scanUTF8(str.data(), str.size(), needsConversion);
+}
+
+//Encoded size of a tag excluding its children, the sum over all tags is the size of the document.
+size_t ownEncodedSize(const NBT_TagBase* tag, bool named) {
+	const size_t headerSize{ named ? sizeof(int8_t) + sizeof(int16_t) + encodedLength(tag->name) : 0u };
+	switch (tag->id) {
+		using enum TagID;
+	case End:
+		return 0u;
+	case Byte:
+		return headerSize + sizeof(int8_t);
+	case Short:
+		return headerSize + sizeof(int16_t);
+	case Int:
+	case Float:
+		return headerSize + sizeof(int32_t);
+	case Long:
+	case Double:
+		return headerSize + sizeof(int64_t);
+	case Byte_Array:
+		return headerSize + sizeof(int32_t) + static_cast<const ByteArray_Tag*>(tag)->values.size() * sizeof(int8_t);
+	case Int_Array:
+		return headerSize + sizeof(int32_t) + static_cast<const IntArray_Tag*>(tag)->values.size() * sizeof(int32_t);
+	case Long_Array:
+		return headerSize + sizeof(int32_t) + static_cast<const LongArray_Tag*>(tag)->values.size() * sizeof(int64_t);
+	case String:
+		return headerSize + sizeof(int16_t) + encodedLength(static_cast<const String_Tag*>(tag)->value);
+	case List:
+		return headerSize + sizeof(int8_t) + sizeof(int32_t);
+	case Compound:
+		return headerSize + sizeof(int8_t); //Closing TAG_End.
+	}
+	return headerSize;
+}
+
+template<typename Func>
+void forEachChild(const NBT_TagBase* tag, Func&& func) {
+	if (tag->id == TagID::Compound) {
+		for (const NBT_TagBase* child : static_cast<const Compound_Tag*>(tag)->values)
+			func(child, true, std::string_view{ child->name }, size_t{ 0u });
+	}
+	else if (tag->id == TagID::List) {
+		const auto& values{ static_cast<const List_Tag*>(tag)->values };
+		for (size_t i = 0u; i < values.size(); ++i)
+			func(values[i], false, std::string_view{}, i);
+	}
+}
+
+void collectStats(const NBT_TagBase* tag, bool named, WorkerState& state) {
+	const size_t type{ static_cast<size_t>(tag->id) };
+	++state.tagCounts[type];
+	state.tagBytes[type] += ownEncodedSize(tag, named);
+	forEachChild(tag, [&](const NBT_TagBase* child, bool childNamed, std::string_view, size_t) {
+		collectStats(child, childNamed, state);
+	});
+}
+
+std::string formatValue(const NBT_TagBase* tag) {
+	std::stringstream ss;
+	auto formatArray = [&](const auto& values) {
+		for (size_t i = 0u; i < values.size(); ++i) {
+			if (i != 0u)
+				ss << ';';
+			if constexpr (sizeof(values[i]) == sizeof(int8_t))
+				ss << int32_t(values[i]);
+			else
+				ss << values[i];
+		}
+	};
+	switch (tag->id) {
+		using enum TagID;
+	case Byte:
+		ss << int32_t(static_cast<const Byte_Tag*>(tag)->value);
+		break;
+	case Short:
+		ss << static_cast<const Short_Tag*>(tag)->value;
+		break;
+	case Int:
+		ss << static_cast<const Int_Tag*>(tag)->value;
+		break;
+	case Long:
+		ss << static_cast<const Long_Tag*>(tag)->value;
+		break;
+	case Float:
+		ss << static_cast<const Float_Tag*>(tag)->value;
+		break;
+	case Double:
+		ss << static_cast<const Double_Tag*>(tag)->value;
+		break;
+	case String:
+		ss << static_cast<const String_Tag*>(tag)->value;
+		break;
+	case Byte_Array:
+		formatArray(static_cast<const ByteArray_Tag*>(tag)->values);
+		break;
+	case Int_Array:
+		formatArray(static_cast<const IntArray_Tag*>(tag)->values);
+		break;
+	case Long_Array:
+		formatArray(static_cast<const LongArray_Tag*>(tag)->values);
+		break;
+	case List:
+		ss << '[' << static_cast<const List_Tag*>(tag)->values.size() << " elements]";
+		break;
+	case Compound:
+		ss << '{' << static_cast<const Compound_Tag*>(tag)->values.size() << " entries}";
+		break;
+	default:
+		break;
+	}
+	return ss.str();
+}
+
+template<typename T>
+std::optional<T> parseNumber(std::string_view text) {
+	T value{};
+	const auto [end, ec] { std::from_chars(text.data(), text.data() + text.size(), value) };
+	if (ec != std::errc{} || end != text.data() + text.size())
+		return std::nullopt;
+	return value;
+}
+
+ValueQuery parseValueQuery(std::string text) {
+	ValueQuery query;
+	query.integer = parseNumber<int64_t>(text);
+	query.singlePrecision = parseNumber<float>(text);
+	query.doublePrecision = parseNumber<double>(text);
+	//Arrays are written as their elements separated by ';', the same way formatValue prints them.
+	std::vector<int64_t> elements;
+	std::string_view rest{ text };
+	while (true) {
+		const size_t separator{ rest.find(';') };
+		const auto element{ parseNumber<int64_t>(rest.substr(0u, separator)) };
+		if (!element)
+			break;
+		elements.push_back(*element);
+		if (separator == std::string_view::npos) {
+			query.elements = std::move(elements);
+			break;
+		}
+		rest.remove_prefix(separator + 1u);
+	}
+	query.text = std::move(text);
+	return query;
+}
+
+//Compares a tag against the query without formatting it, find visits every tag of the world.
+bool matchesValue(const NBT_TagBase* tag, const ValueQuery& query) {
+	auto matchesArray = [&](const auto& values) {
+		return query.elements && std::equal(values.begin(), values.end(), query.elements->begin(), query.elements->end(),
+			[](auto value, int64_t element) { return int64_t(value) == element; });
+	};
+	switch (tag->id) {
+		using enum TagID;
+	case Byte:
+		return query.integer && static_cast<const Byte_Tag*>(tag)->value == *query.integer;
+	case Short:
+		return query.integer && static_cast<const Short_Tag*>(tag)->value == *query.integer;
+	case Int:
+		return query.integer && static_cast<const Int_Tag*>(tag)->value == *query.integer;
+	case Long:
+		return query.integer && static_cast<const Long_Tag*>(tag)->value == *query.integer;
+	case Float:
+		return query.singlePrecision && static_cast<const Float_Tag*>(tag)->value == *query.singlePrecision;
+	case Double:
+		return query.doublePrecision && static_cast<const Double_Tag*>(tag)->value == *query.doublePrecision;
+	case String:
+		return std::string_view{ static_cast<const String_Tag*>(tag)->value } == query.text;
+	case Byte_Array:
+		return matchesArray(static_cast<const ByteArray_Tag*>(tag)->values);
+	case Int_Array:
+		return matchesArray(static_cast<const IntArray_Tag*>(tag)->values);
+	case Long_Array:
+		return matchesArray(static_cast<const LongArray_Tag*>(tag)->values);
+	default:
+		return false;
+	}
+}
+
+void findTags(const NBT_TagBase* tag, std::string& path, const ScanOptions& options, const std::string& source, WorkerState& state) {
+	forEachChild(tag, [&](const NBT_TagBase* child, bool named, std::string_view name, size_t index) {
+		const size_t pathLength{ path.size() };
+		if (named) {
+			if (!path.empty())
+				path += '.';
+			path += name;
+		}
+		else {
+			path += '[' + std::to_string(index) + ']';
+		}
+
+		bool match{ false };
+		if (!options.findKey.empty())
+			match = named && name == options.findKey;
+		else
+			match = matchesValue(child, options.findValue);
+
+		if (match)
+			state.outputLines.push_back(source + ": " + path);
+
+		findTags(child, path, options, source, state);
+		path.resize(pathLength);
+	});
+}
+
+//Resolves a path such as "Data.Player.Pos[1]" relative to the root compound.
+const NBT_TagBase* findTagByPath(const Compound_Tag* root, std::string_view path) {
+	const NBT_TagBase* current{ root };
+	while (!path.empty() && current) {
+		if (path.front() == '[') {
+			const size_t close{ path.find(']') };
+			size_t index{ 0u };
+			if (current->id != TagID::List || close == std::string_view::npos
+				|| std::from_chars(path.data() + 1, path.data() + close, index).ec != std::errc{})
+				return nullptr;
+			const auto& values{ static_cast<const List_Tag*>(current)->values };
+			current = index < values.size() ? values[index] : nullptr;
+			path.remove_prefix(close + 1u);
+		}
+		else {
+			if (path.front() == '.')
+				path.remove_prefix(1u);
+			const size_t end{ std::min(path.find('.'), path.find('[')) };
+			const std::string_view name{ path.substr(0u, end) };
+			if (current->id != TagID::Compound)
+				return nullptr;
+			const Compound_Tag* compound{ static_cast<const Compound_Tag*>(current) };
+			const auto it{ compound->indexMap.find(std::pmr::string{ name }) };
+			current = it != compound->indexMap.end() ? compound->values[it->second] : nullptr;
+			path.remove_prefix(std::min(end, path.size()));
+		}
+	}
+	return current;
+}
+
+std::string escapeCSV(const std::string& value) {
+	if (value.find_first_of(",\"\n") == std::string::npos)
+		return value;
+	std::string escaped{ "\"" };
+	for (char c : value) {
+		if (c == '"')
+			escaped += '"';
+		escaped += c;
+	}
+	return escaped + '"';
+}
+
+//Checks that encoding the parsed tree reproduces the input byte for byte.
+bool roundTrips(const Compound_Tag& root, const std::vector<byte>& input) {
+	if (input.size() < 3u)
+		return false;
+	const size_t rootNameLength{ size_t(copyAndFlipBytes<uint16_t>(const_cast<byte*>(input.data()) + 1u)) };
+	const std::vector<byte> encoded{ buildBinaryNBTFile(&root) };
+	//parseNBT does not keep the name of the root tag, so only the payloads are compared.
+	const size_t inputPayload{ 3u + rootNameLength };
+	return encoded.size() - 3u == input.size() - inputPayload
+		&& std::equal(encoded.begin() + 3, encoded.end(), input.begin() + inputPayload);
+}
+
+void processDocument(const std::vector<byte>& data, const std::string& source, const ScanOptions& options, WorkerState& state) {
+	++state.documents;
+	state.decodedBytes += data.size();
+
+	auto start{ Clock::now() };
+	if (options.operation == Operation::Validate) {
+		//Check the structure without allocating first, so malformed documents are reported with the offset of the problem.
+		const NBT_ValidationResult validation{ validateNBT(data.data(), data.size()) };
+		state.operationTime += Clock::now() - start;
+		if (!validation) {
+			++state.failures;
+			state.outputLines.push_back(source + ": " + validation.error + " (offset " + std::to_string(validation.errorOffset) + ')');
+			return;
+		}
+		start = Clock::now();
+	}
+	try {
+		Compound_Tag root{ parseNBT(const_cast<byte*>(data.data()), data.size(), &state.arena) };
+		auto parsed{ Clock::now() };
+		state.parseTime += parsed - start;
+
+		switch (options.operation) {
+			using enum Operation;
+		case Stats:
+			collectStats(&root, true, state);
+			break;
+		case Find: {
+			std::string path;
+			findTags(&root, path, options, source, state);
+			break;
+		}
+		case Extract: {
+			std::string line{ escapeCSV(source) };
+			for (const auto& path : options.extractPaths) {
+				line += ',';
+				if (const NBT_TagBase* tag{ findTagByPath(&root, path) })
+					line += escapeCSV(formatValue(tag));
+			}
+			state.outputLines.push_back(std::move(line));
+			break;
+		}
+		case Validate:
+			if (!roundTrips(root, data)) {
+				++state.failures;
+				state.outputLines.push_back(source + ": encoding the parsed document does not reproduce the input");
+			}
+			break;
+		}
+		state.operationTime += Clock::now() - parsed;
+	}
+	catch (const std::exception& e) {
+		++state.failures;
+		state.outputLines.push_back(source + ": " + e.what());
+	}
+	state.arena.release();
+}
+
+void processWorkItem(const WorkItem& item, const ScanOptions& options, WorkerState& state) {
+	++state.files;
+	const std::string fileName{ item.path.lexically_relative(options.worldDir).generic_string() };
+	try {
+		auto start{ Clock::now() };
+		if (item.isRegion) {
+			RegionReader region{ item.path };
+			state.readTime += Clock::now() - start;
+
+			for (size_t i = 0u; i < REGION_CHUNK_COUNT; ++i) {
+				if (!region.hasChunk(i))
+					continue;
+				const std::string source{ fileName + '[' + std::to_string(i % 32u) + ',' + std::to_string(i / 32u) + ']' };
+
+				start = Clock::now();
+				size_t compressedSize{ 0u };
+				try {
+					region.readChunk(i, state.documentBuffer, &compressedSize);
+				}
+				catch (const std::exception& e) {
+					++state.failures;
+					state.outputLines.push_back(source + ": " + e.what());
+					continue;
+				}
+				state.compressedBytes += compressedSize;
+				state.decompressTime += Clock::now() - start;
+
+				processDocument(state.documentBuffer, source, options, state);
+			}
+		}
+		else {
+			state.fileBuffer = loadFileBytes(item.path);
+			auto read{ Clock::now() };
+			state.readTime += read - start;
+			state.compressedBytes += state.fileBuffer.size();
+
+			if (isCompressed(state.fileBuffer.data(), state.fileBuffer.size()))
+				decompressData(state.fileBuffer.data(), state.fileBuffer.size(), state.documentBuffer);
+			else
+				state.documentBuffer.assign(state.fileBuffer.begin(), state.fileBuffer.end());
+			state.decompressTime += Clock::now() - read;
+
+			processDocument(state.documentBuffer, fileName, options, state);
+		}
+	}
+	catch (const std::exception& e) {
+		++state.failures;
+		state.outputLines.push_back(fileName + ": " + e.what());
+	}
+}
+
+std::vector<WorkItem> collectWorkItems(const fs::path& worldDir) {
+	std::vector<WorkItem> items;
+	for (const auto& entry : fs::recursive_directory_iterator(worldDir, fs::directory_options::skip_permission_denied)) {
+		if (!entry.is_regular_file())
+			continue;
+		const auto extension{ entry.path().extension() };
+		if (extension != ".mca" && extension != ".dat")
+			continue;
+		std::error_code error;
+		const uintmax_t fileSize{ entry.file_size(error) };
+		items.push_back({ entry.path(), extension == ".mca", error ? 0u : fileSize });
+	}
+	//Largest files first, so a single big region does not end up being processed last.
+	std::sort(items.begin(), items.end(), [](const WorkItem& a, const WorkItem& b) {
+		return a.fileSize > b.fileSize;
+	});
+	return items;
+}
+
+ScanOptions parseArguments(int argc, char** argv) {
+	if (argc < 3)
+		throw std::invalid_argument("Usage: NBT_WorldScan <worldDir> <stats|find|extract|validate> [arguments] [-j threads] [-o output.csv]");
+
+	ScanOptions options;
+	options.worldDir = argv[1];
+	const std::string operation{ argv[2] };
+	if (operation == "stats")
+		options.operation = Operation::Stats;
+	else if (operation == "find")
+		options.operation = Operation::Find;
+	else if (operation == "extract")
+		options.operation = Operation::Extract;
+	else if (operation == "validate")
+		options.operation = Operation::Validate;
+	else
+		throw std::invalid_argument("Unknown operation: " + operation);
+
+	for (int i = 3; i < argc; ++i) {
+		const std::string arg{ argv[i] };
+		const bool hasValue{ i + 1 < argc };
+		if (arg == "-j" && hasValue)
+			options.threadCount = std::stoul(argv[++i]);
+		else if (arg == "-o" && hasValue)
+			options.outputPath = argv[++i];
+		else if (arg == "--key" && hasValue)
+			options.findKey = argv[++i];
+		else if (arg == "--value" && hasValue)
+			options.findValue = parseValueQuery(argv[++i]);
+		else if (options.operation == Operation::Extract)
+			options.extractPaths.push_back(arg);
+		else
+			throw std::invalid_argument("Unknown argument: " + arg);
+	}
+
+	if (options.operation == Operation::Find && options.findKey.empty() && options.findValue.text.empty())
+		throw std::invalid_argument("find requires either --key <name> or --value <value>");
+	if (options.operation == Operation::Extract && options.extractPaths.empty())
+		throw std::invalid_argument("extract requires at least one path");
+	if (!fs::is_directory(options.worldDir))
+		throw std::invalid_argument("Not a directory: " + options.worldDir.string());
+
+	return options;
+}
+
+double toSeconds(Clock::duration duration) {
+	return std::chrono::duration<double>(duration).count();
+}
+
+int main(int argc, char** argv) {
+	ScanOptions options;
+	try {
+		options = parseArguments(argc, argv);
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << '\n';
+		return 2;
+	}
+
+	const auto scanStart{ Clock::now() };
+	const std::vector<WorkItem> items{ collectWorkItems(options.worldDir) };
+	const auto collected{ Clock::now() };
+
+	size_t threadCount{ options.threadCount != 0u ? options.threadCount : std::max(1u, std::thread::hardware_concurrency()) };
+	std::vector<WorkerState> workers(threadCount);
+	parallelFor(items.size(), threadCount, [&](size_t index, size_t worker) {
+		processWorkItem(items[index], options, workers[worker]);
+	});
+	const auto scanEnd{ Clock::now() };
+
+	WorkerState total;
+	for (WorkerState& worker : workers) {
+		for (size_t i = 0u; i < TAG_TYPE_COUNT; ++i) {
+			total.tagCounts[i] += worker.tagCounts[i];
+			total.tagBytes[i] += worker.tagBytes[i];
+		}
+		total.outputLines.insert(total.outputLines.end(), std::make_move_iterator(worker.outputLines.begin()), std::make_move_iterator(worker.outputLines.end()));
+		total.files += worker.files;
+		total.documents += worker.documents;
+		total.failures += worker.failures;
+		total.compressedBytes += worker.compressedBytes;
+		total.decodedBytes += worker.decodedBytes;
+		total.readTime += worker.readTime;
+		total.decompressTime += worker.decompressTime;
+		total.parseTime += worker.parseTime;
+		total.operationTime += worker.operationTime;
+	}
+
+	std::ofstream outputFile;
+	if (!options.outputPath.empty()) {
+		outputFile.open(options.outputPath);
+		if (!outputFile.is_open()) {
+			std::cerr << "Output file could not be opened: " << options.outputPath.string() << '\n';
+			return 2;
+		}
+	}
+	std::ostream& output{ outputFile.is_open() ? outputFile : std::cout };
+
+	if (options.operation == Operation::Extract) {
+		output << "source";
+		for (const auto& path : options.extractPaths)
+			output << ',' << escapeCSV(path);
+		output << '\n';
+	}
+	for (const auto& line : total.outputLines)
+		output << line << '\n';
+
+	if (options.operation == Operation::Stats) {
+		output << "tag,count,bytes\n";
+		for (size_t i = 1u; i < TAG_TYPE_COUNT; ++i)
+			output << TagIDToString(static_cast<TagID>(i)) << ',' << total.tagCounts[i] << ',' << total.tagBytes[i] << '\n';
+	}
+
+	const double wallSeconds{ toSeconds(scanEnd - scanStart) };
+	const double workSeconds{ toSeconds(total.readTime + total.decompressTime + total.parseTime + total.operationTime) };
+	auto printStage = [&](const char* stage, Clock::duration duration) {
+		const double seconds{ toSeconds(duration) };
+		std::cerr << "  " << stage << ": " << seconds << " s (" << (workSeconds > 0.0 ? seconds / workSeconds * 100.0 : 0.0) << "%)\n";
+	};
+	std::cerr << "Scanned " << total.files << " files, " << total.documents << " documents with " << threadCount << " threads in " << wallSeconds << " s\n"
+		<< "  failures: " << total.failures << '\n'
+		<< "  compressed: " << total.compressedBytes / 1e6 << " MB, decoded: " << total.decodedBytes / 1e6 << " MB\n"
+		<< "  throughput: " << (wallSeconds > 0.0 ? total.decodedBytes / 1e6 / wallSeconds : 0.0) << " MB/s decoded, "
+		<< (wallSeconds > 0.0 ? total.documents / wallSeconds : 0.0) << " documents/s\n"
+		<< "  directory walk: " << toSeconds(collected - scanStart) << " s\n"
+		<< "Stage times summed over all workers:\n";
+	printStage("read", total.readTime);
+	printStage("decompress", total.decompressTime);
+	printStage("parse", total.parseTime);
+	printStage("operation", total.operationTime);
+
+	return total.failures == 0u ? 0 : 1;
+}
@@ -1,7 +1,11 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
+#include <memory>
 #include "NBT_Lib.h"
+#include "NBT_LibValidate.h"
+#include "NBT_LibMemory.h"
+#include "NBT_LibWriter.h"
 
 
 std::vector<char> loadBinaryFile(std::string filepath) {
@@ -23,30 +27,33 @@ std::vector<char> loadBinaryFile(std::string filepath) {
 
 NBT_Lib::Compound_Tag Example_Compose_NBT( std::pmr::memory_resource* memRes) {
 	using namespace NBT_Lib;
-	Compound_Tag root("", {}, memRes);
+	Compound_Tag root("", memRes);
+	root.reserve(5u);
 
-	root.addTag(new(allocateMemory<String_Tag>(memRes)) String_Tag("Example_String", "Example", memRes));
+	root.emplace<String_Tag>("Example_String", "Example");
 
-	LongArray_Tag* longArr{ new(allocateMemory<LongArray_Tag>(memRes)) LongArray_Tag("Longs", {64u, 128u, 256u, 512u, 1028u, 2056u, 4112u, 8224u, 16448u}, memRes) };
-	root.addTag(longArr);
+	const int64_t longs[]{ 64, 128, 256, 512, 1028, 2056, 4112, 8224, 16448 };
+	LongArray_Tag& longArr{ root.emplaceArray<LongArray_Tag>("Longs", longs) };
 
-	List_Tag* floatList{ new(allocateMemory<List_Tag>(memRes)) List_Tag("Float_List", TagID::Float, {}, memRes)};
+	//Vectors allocated from the same memory resource are taken over instead of copied.
+	std::pmr::vector<int32_t> ints(16u, 7, memRes);
+	root.emplace<IntArray_Tag>("Ints", std::move(ints));
+
+	List_Tag& floatList{ root.emplace<List_Tag>("Float_List", TagID::Float) };
+	floatList.reserve(8u);
 	for (size_t i = 0u; i < 8u; ++i) {
-		floatList->values.push_back(new(allocateMemory<Float_Tag>(memRes)) Float_Tag("", float(i) * .3f, memRes));
+		floatList.emplace<Float_Tag>(float(i) * .3f);
 	}
-	root.addTag(floatList);
 
-	List_Tag* compList{ new(allocateMemory<List_Tag>(memRes)) List_Tag("Compound_List", TagID::Compound, {}, memRes) };
-	root.addTag(compList);
+	List_Tag& compList{ root.emplace<List_Tag>("Compound_List", TagID::Compound) };
 
-	Compound_Tag* comp{ new(allocateMemory<Compound_Tag>(memRes)) Compound_Tag("", {}, memRes) };
-	compList->values.push_back(comp);
-	comp->addTag(copyTag(longArr, memRes));
-	comp->addTag(copyTag(floatList, memRes));
+	Compound_Tag& comp{ compList.emplace<Compound_Tag>() };
+	comp.addTag(copyTag(&longArr, memRes));
+	comp.addTag(copyTag(&floatList, memRes));
 
-	compList->values.push_back(copyTag(comp, memRes));
+	compList.values.push_back(copyTag(&comp, memRes));
 
-	comp->addTag(copyTag(compList->values.back(), memRes));
+	comp.addTag(copyTag(compList.values.back(), memRes));
 
 	return root;
 }
@@ -57,11 +64,53 @@ NBT_Lib::Compound_Tag Example_Read_NBT_From_File(std::pmr::memory_resource* memR
 	return root;
 }
 
+//Data received from clients is validated before parsing, and the arena is sized from the validation result.
+NBT_Lib::Compound_Tag Example_Parse_Untrusted_NBT(std::vector<char>& data, std::unique_ptr<std::pmr::monotonic_buffer_resource>& out_arena) {
+	NBT_Lib::NBT_Limits limits;
+	limits.maxMemory = 1u << 20u;
+
+	const NBT_Lib::NBT_ValidationResult validation{ NBT_Lib::validateNBT(data.data(), data.size(), limits) };
+	if (!validation)
+		throw std::runtime_error(std::string("Rejected NBT data: ") + validation.error);
+
+	out_arena = std::make_unique<std::pmr::monotonic_buffer_resource>(std::max<size_t>(validation.requiredMemory, 1u));
+	return NBT_Lib::parseNBT(data.data(), validation.documentSize, out_arena.get());
+}
+
+//Each parse gets a hard memory budget, a document needing more fails with MemoryBudgetExceeded and frees what it allocated.
+size_t Example_Count_Tags_With_Budget(std::vector<char>& data) {
+	std::pmr::monotonic_buffer_resource arena;
+	NBT_Lib::BudgetMemoryResource budget(1u << 20u, &arena);
+	try {
+		auto root{ NBT_Lib::parseNBT(data.data(), data.size(), &budget) };
+		return root.values.size();
+	}
+	catch (const NBT_Lib::MemoryBudgetExceeded&) {
+		return 0u;
+	}
+}
+
 std::vector<std::byte> Example_Encode_NBT_As_Binary(std::pmr::memory_resource* memRes) {
 	auto root{ Example_Compose_NBT(memRes) };
 	auto data{ NBT_Lib::buildBinaryNBTFile(&root) };
 	return data;
 }
+//Data already held in native structs is written directly, without building a tree of tags first.
+std::vector<std::byte> Example_Write_NBT_Directly(const std::vector<int64_t>& blockStates, double x, double y, double z) {
+	std::vector<std::byte> data;
+	NBT_Lib::NBT_Writer writer(data);
+	writer.beginCompound("");
+	writer.writeInt("DataVersion", 3700);
+	writer.writeLongArray("BlockStates", blockStates);
+	writer.beginList("Pos", NBT_Lib::TagID::Double, 3u);
+	writer.writeDouble(x);
+	writer.writeDouble(y);
+	writer.writeDouble(z);
+	writer.end();
+	writer.end();
+	writer.finish();
+	return data;
+}
 /*
 int main() {
 
@@ -0,0 +1,175 @@
+#include <random>
+#include <memory_resource>
+
+#include "TestUtil.h"
+#include "NBT_Lib.h"
+#include "NBT_LibAsync.h"
+#include "NBT_LibHash.h"
+#include "NBT_LibMemory.h"
+#include "NBT_LibValidate.h"
+
+using namespace NBT_Lib;
+using NBT_LibTest::RawDocument;
+
+namespace {
+	NBT_Task<void> produceDocument(NBT_AsyncInput& input, const Compound_Tag* root, size_t chunkSize, NBT_LocalExecutor& executor, size_t& out_maxBuffered) {
+		for (NBT_ChunkGenerator chunks{ encodeAsync(root, chunkSize) }; chunks.next();) {
+			co_await input.write(chunks.chunk().data(), chunks.chunk().size());
+			out_maxBuffered = std::max(out_maxBuffered, input.getBuffered());
+			co_await executor.yield();
+		}
+		input.close();
+	}
+
+	NBT_Task<void> produceBytes(NBT_AsyncInput& input, std::span<const byte> data, size_t chunkSize) {
+		for (size_t offset = 0u; offset < data.size(); offset += chunkSize)
+			co_await input.write(data.data() + offset, std::min(chunkSize, data.size() - offset));
+		input.close();
+	}
+
+	NBT_Task<bool> consume(NBT_AsyncInput& input, std::pmr::memory_resource* memRes, const Compound_Tag* expected) {
+		Compound_Tag root{ co_await decodeAsync(input, memRes) };
+		co_return tagsEqual(&root, expected);
+	}
+
+	struct Sample {
+		std::pmr::monotonic_buffer_resource arena;
+		Compound_Tag root{ "", &arena };
+		std::vector<byte> encoded;
+
+		Sample() {
+			NBT_LibTest::fillSampleDocument(root);
+			std::mt19937_64 rng{ 3u };
+			std::vector<int64_t> longs(100000u);
+			for (int64_t& value : longs)
+				value = int64_t(rng());
+			root.emplaceArray<LongArray_Tag>("bigLongs", longs);
+			root.emplaceArray<ByteArray_Tag>("bigBytes", std::vector<int8_t>(200000u, 3));
+			root.emplace<String_Tag>("nul", std::string_view{ "a\0b", 3u });
+			encoded = buildBinaryNBTFile(&root);
+		}
+	};
+
+	void testEncodeChunks() {
+		Sample sample;
+		for (const size_t chunkSize : { 1u, 7u, 4096u, 1u << 16u, 1u << 24u }) {
+			std::vector<byte> joined;
+			size_t chunks{ 0u };
+			for (NBT_ChunkGenerator generator{ encodeAsync(&sample.root, chunkSize) }; generator.next(); ++chunks) {
+				CHECK(!generator.chunk().empty() && generator.chunk().size() <= chunkSize);
+				joined.insert(joined.end(), generator.chunk().begin(), generator.chunk().end());
+			}
+			CHECK(joined == sample.encoded);
+			CHECK(chunks == (sample.encoded.size() + chunkSize - 1u) / chunkSize);
+		}
+	}
+
+	void testDecodeInline() {
+		Sample sample;
+		std::mt19937 rng{ 4u };
+		for (int repetition = 0; repetition < 3; ++repetition) {
+			std::pmr::monotonic_buffer_resource arena;
+			NBT_AsyncInput input;
+			NBT_Task<Compound_Tag> task{ decodeAsync(input, &arena) };
+			task.start();
+			for (size_t offset = 0u; offset < sample.encoded.size();) {
+				const size_t size{ std::min<size_t>(sample.encoded.size() - offset, repetition == 0 ? 1u : 1u + rng() % 100000u) };
+				input.push(sample.encoded.data() + offset, size);
+				offset += size;
+				CHECK(input.getBuffered() < (1u << 17u));
+			}
+			CHECK(task.done());
+			const Compound_Tag root{ task.get() };
+			CHECK(tagsEqual(&root, &sample.root));
+		}
+	}
+
+	void testBackpressure() {
+		Sample sample;
+		NBT_LocalExecutor executor;
+		std::pmr::monotonic_buffer_resource arena;
+		NBT_AsyncInput input{ 4096u, executor.getScheduler() };
+		size_t maxBuffered{ 0u };
+		NBT_Task<void> producer{ produceDocument(input, &sample.root, 1000u, executor, maxBuffered) };
+		NBT_Task<bool> consumer{ consume(input, &arena, &sample.root) };
+		executor.spawn(consumer);
+		executor.spawn(producer);
+		executor.run();
+		CHECK(producer.done() && consumer.done());
+		CHECK(consumer.get());
+		//Capacity, one write and the largest piece the decoder waits for.
+		CHECK(maxBuffered < 4096u + 1000u + (1u << 16u));
+	}
+
+	void testFailures() {
+		Sample sample;
+		std::pmr::monotonic_buffer_resource arena;
+		BudgetMemoryResource budget{ SIZE_MAX, &arena };
+
+		//The input ends early.
+		for (const size_t size : { size_t{ 0u }, size_t{ 1u }, size_t{ 5u }, size_t{ 100u }, sample.encoded.size() / 2u, sample.encoded.size() - 1u }) {
+			NBT_AsyncInput input;
+			NBT_Task<Compound_Tag> task{ decodeAsync(input, &budget) };
+			task.start();
+			input.push(sample.encoded.data(), size);
+			CHECK(!task.done());
+			input.close();
+			CHECK(task.done());
+			CHECK_THROWS(task.get(), std::out_of_range);
+			CHECK(budget.getUsed() == 0u);
+		}
+
+		std::vector<byte> invalidID{ sample.encoded };
+		invalidID[3] = byte{ 99 };
+		RawDocument deep;
+		deep.tag(TagID::Compound, "");
+		for (size_t i = 0u; i < NBT_MAX_DEPTH + 10u; ++i)
+			deep.tag(TagID::Compound, "");
+		for (const std::vector<byte>* data : { &invalidID, &deep.data }) {
+			NBT_AsyncInput input;
+			NBT_Task<Compound_Tag> task{ decodeAsync(input, &budget) };
+			task.start();
+			input.push(data->data(), data->size());
+			CHECK_THROWS(task.get(), std::runtime_error);
+			CHECK(budget.getUsed() == 0u);
+
+			//A producer waiting for the decoder is released when decoding fails.
+			for (const size_t chunkSize : { 100u, 1u << 20u }) {
+				NBT_LocalExecutor executor;
+				NBT_AsyncInput limitedInput{ 64u, executor.getScheduler() };
+				NBT_Task<bool> consumer{ consume(limitedInput, &arena, &sample.root) };
+				NBT_Task<void> producer{ produceBytes(limitedInput, *data, chunkSize) };
+				executor.spawn(consumer);
+				executor.spawn(producer);
+				executor.run();
+				CHECK(consumer.done() && producer.done());
+				CHECK_THROWS(consumer.get(), std::runtime_error);
+			}
+		}
+
+		//The memory budget runs out.
+		budget.setBudget(10000u);
+		NBT_AsyncInput input;
+		NBT_Task<Compound_Tag> task{ decodeAsync(input, &budget) };
+		task.start();
+		input.push(sample.encoded.data(), sample.encoded.size());
+		CHECK_THROWS(task.get(), MemoryBudgetExceeded);
+		CHECK(budget.getUsed() == 0u);
+
+		//A task destroyed while waiting for data.
+		{
+			NBT_AsyncInput waitingInput;
+			NBT_Task<Compound_Tag> waitingTask{ decodeAsync(waitingInput, &arena) };
+			waitingTask.start();
+			waitingInput.push(sample.encoded.data(), sample.encoded.size() / 3u);
+		}
+	}
+}
+
+int main() {
+	testEncodeChunks();
+	testDecodeInline();
+	testBackpressure();
+	testFailures();
+	return NBT_LibTest::testResult();
+}
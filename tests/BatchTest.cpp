@@ -0,0 +1,68 @@
+#include <memory_resource>
+#include <atomic>
+
+#include "TestUtil.h"
+#include "NBT_Lib.h"
+#include "NBT_LibBatch.h"
+
+using namespace NBT_Lib;
+
+namespace {
+	void testWorkerPool() {
+		WorkerPool pool{ 4u };
+		CHECK(pool.size() == 4u);
+		//The same threads run one loop after another.
+		for (size_t round = 0u; round < 200u; ++round) {
+			std::vector<size_t> values(round);
+			std::vector<size_t> workers(round);
+			parallelFor(pool, values.size(), [&](size_t i, size_t worker) {
+				values[i] = i * 3u;
+				workers[i] = worker;
+			});
+			size_t correct{ 0u };
+			for (size_t i = 0u; i < values.size(); ++i)
+				correct += values[i] == i * 3u && workers[i] < pool.size() ? 1u : 0u;
+			CHECK(correct == round);
+		}
+
+		CHECK_THROWS(parallelFor(pool, 100u, [](size_t i, size_t) {
+			if (i == 42u)
+				throw std::out_of_range("42");
+		}), std::out_of_range);
+		//The pool is still usable after a loop threw.
+		std::atomic<size_t> count{ 0u };
+		parallelFor(pool, 1000u, [&](size_t, size_t) { ++count; });
+		CHECK(count == 1000u);
+	}
+
+	void testBatchEncoder() {
+		std::pmr::monotonic_buffer_resource arena;
+		std::vector<Compound_Tag> documents;
+		documents.reserve(300u);
+		std::vector<const Compound_Tag*> roots;
+		for (int i = 0; i < 300; ++i) {
+			Compound_Tag& root{ documents.emplace_back("", &arena) };
+			NBT_LibTest::fillSampleDocument(root);
+			root.emplace<Int_Tag>("index", i);
+			roots.push_back(&root);
+		}
+
+		NBT_BatchEncoder encoder{ FrameFormat::None, 4u };
+		NBT_EncodedBatch batch;
+		for (const size_t count : { size_t{ 300u }, size_t{ 10u }, size_t{ 300u }, size_t{ 200u } }) {
+			encoder.encode(std::span{ roots.data(), count }, batch);
+			CHECK(batch.size() == count);
+			for (size_t i = 0u; i < count; ++i) {
+				const std::vector<byte> expected{ buildBinaryNBTFile(roots[i]) };
+				const std::span<const byte> frame{ batch.frame(i) };
+				CHECK(std::equal(frame.begin(), frame.end(), expected.begin(), expected.end()));
+			}
+		}
+	}
+}
+
+int main() {
+	testWorkerPool();
+	testBatchEncoder();
+	return NBT_LibTest::testResult();
+}
@@ -0,0 +1,80 @@
+#include <memory_resource>
+
+#include "TestUtil.h"
+#include "NBT_Lib.h"
+#include "NBT_LibColumns.h"
+#include "NBT_LibPatch.h"
+
+using namespace NBT_Lib;
+
+namespace {
+	std::vector<byte> sampleDocument() {
+		std::pmr::monotonic_buffer_resource arena;
+		Compound_Tag root{ "", &arena };
+		NBT_LibTest::fillSampleDocument(root);
+		return buildBinaryNBTFile(&root);
+	}
+
+	//findRawEntries resolves every path like findRawEntry does on its own.
+	void testPathSet() {
+		std::vector<byte> document{ sampleDocument() };
+		const std::vector<std::string_view> paths{ "int", "pos[1]", "ints[2]", "longs[5]", "entities[2].id", "entities[3].inventory[0].count",
+			"entities[1].nested[0][0]", "data.player.level", "data.player", "missing", "int.x", "int[0]", "entities[9].id", "", "int" };
+		const NBT_RawPathSet pathSet{ paths };
+		CHECK(pathSet.size() == paths.size());
+
+		byte* const compound{ document.data() + sizeof(int8_t) + sizeof(int16_t) }; //The root has an empty name.
+		const size_t compoundSize{ document.size() - sizeof(int8_t) - sizeof(int16_t) };
+		std::vector<NBT_RawTag> tags(paths.size());
+		CHECK(findRawEntries(compound, compoundSize, pathSet, tags) == compoundSize);
+		for (size_t i = 0u; i < paths.size(); ++i) {
+			const NBT_RawTag expected{ findRawEntry(compound, compoundSize, paths[i]) };
+			CHECK(tags[i].payload == expected.payload);
+			CHECK(tags[i].type == expected.type);
+			CHECK(tags[i].elementType == expected.elementType);
+			CHECK(tags[i].count == expected.count);
+		}
+		CHECK(tags[0] && readRawValue<int32_t>(tags[0]) == 123456789);
+		CHECK(!tags[9] && !tags[10] && !tags[12]);
+
+		std::vector<NBT_RawTag> tooFew(1u);
+		CHECK_THROWS(findRawEntries(compound, compoundSize, pathSet, tooFew), std::invalid_argument);
+		CHECK_THROWS(findRawEntries(compound, compoundSize - 1u, pathSet, tags), std::out_of_range);
+	}
+
+	void testExtract() {
+		const std::vector<byte> document{ sampleDocument() };
+		const std::span<const byte> documents[]{ document, std::span{ document.data(), 20u }, document };
+		const NBT_ColumnExtractor extractor{ { { "id", TagID::String }, { "health", TagID::Float }, { "inventory[0].count", TagID::Byte },
+			{ "nested[0][0]", TagID::String }, { "id", TagID::Int } }, "entities" };
+		const NBT_ColumnBatch batch{ extractor.extract(documents, 2u) };
+
+		CHECK(batch.rowCount() == 8u);
+		CHECK(batch.failedDocuments == std::vector<size_t>{ 1u });
+		CHECK(batch.documentIndex[3] == 0u && batch.documentIndex[4] == 2u);
+		for (size_t row = 0u; row < batch.rowCount(); ++row) {
+			const size_t entity{ row % 4u };
+			CHECK(batch.columns[0].strings()[row] == (entity % 2u == 0u ? "minecraft:pig" : "minecraft:zombie"));
+			CHECK(batch.columns[1].values<float>()[row] == 20.0f - float(entity));
+			CHECK(batch.columns[2].values<int8_t>()[row] == int8_t(entity));
+			CHECK(batch.columns[3].strings()[row] == "deep");
+			CHECK(batch.columns[4].isNull(row)); //The type does not match.
+		}
+		CHECK(batch.columns[4].getNullCount() == batch.rowCount());
+	}
+
+	void testInvalidPaths() {
+		CHECK_THROWS((NBT_ColumnExtractor{ { { "inventory[x].count", TagID::Byte } } }), std::invalid_argument);
+		CHECK_THROWS((NBT_ColumnExtractor{ { { "pos[1", TagID::Double } } }), std::invalid_argument);
+		CHECK_THROWS((NBT_ColumnExtractor{ { { "id", TagID::String } }, "entities[" }), std::invalid_argument);
+		CHECK_THROWS((NBT_ColumnExtractor{ { { "pos", TagID::List } } }), std::invalid_argument);
+		CHECK_NOTHROW((NBT_ColumnExtractor{ { { "a.b[0][1].c", TagID::Int } }, "x[3].y" }));
+	}
+}
+
+int main() {
+	testPathSet();
+	testExtract();
+	testInvalidPaths();
+	return NBT_LibTest::testResult();
+}
@@ -0,0 +1,125 @@
+#include <random>
+#include <memory_resource>
+
+#include "TestUtil.h"
+#include "NBT_Lib.h"
+#include "NBT_LibCompression.h"
+#include "NBT_LibWriter.h"
+
+using namespace NBT_Lib;
+
+namespace {
+	//Partly compressible data.
+	std::vector<byte> makeData(size_t size, std::mt19937& rng) {
+		std::vector<byte> data(size);
+		for (size_t i = 0u; i < size; ++i)
+			data[i] = static_cast<byte>(i % 97u < 50u ? (i / 7u) & 0xffu : rng() % 16u);
+		return data;
+	}
+
+	//Compresses data through a CompressionStream in randomly sized pieces.
+	std::vector<byte> compressInPieces(const std::vector<byte>& data, const CompressionOptions& options, std::mt19937& rng) {
+		std::vector<byte> out;
+		CompressionStream stream{ out, options };
+		for (size_t offset = 0u; offset < data.size();) {
+			const size_t size{ std::min<size_t>(data.size() - offset, 1u + rng() % 50000u) };
+			stream.write(data.data() + offset, size);
+			offset += size;
+		}
+		stream.finish();
+		CHECK(stream.getBytesIn() == data.size());
+		return out;
+	}
+
+	void testThreadedMatchesSingleThreaded() {
+		std::mt19937 rng{ 1u };
+		for (const CompressionFormat format : { CompressionFormat::Zlib, CompressionFormat::GZip, CompressionFormat::Raw }) {
+			const CompressionFormat decompressFormat{ format == CompressionFormat::Raw ? CompressionFormat::Raw : CompressionFormat::Auto };
+			for (const size_t size : { 0u, 1u, 1000u, 65536u, 65537u, 300000u, 1500000u }) {
+				const std::vector<byte> data{ makeData(size, rng) };
+
+				const std::vector<byte> single{ compressInPieces(data, { format, 6, 1u, 1u << 16u }, rng) };
+				CHECK(decompressData(single.data(), single.size(), decompressFormat) == data);
+				const std::vector<byte> direct{ compressData(data.data(), data.size(), format, 6) };
+				CHECK(decompressData(direct.data(), direct.size(), decompressFormat) == data);
+
+				//The blocks only depend on the block size, so every thread count produces the same stream.
+				std::vector<byte> firstThreaded;
+				for (const size_t threads : { 2u, 4u, 7u }) {
+					const std::vector<byte> threaded{ compressInPieces(data, { format, 6, threads, 1u << 16u }, rng) };
+					CHECK(decompressData(threaded.data(), threaded.size(), decompressFormat) == data);
+					if (firstThreaded.empty())
+						firstThreaded = threaded;
+					CHECK(threaded == firstThreaded);
+				}
+				if (size >= 300000u)
+					CHECK(firstThreaded.size() < single.size() + single.size() / 20u);
+			}
+		}
+	}
+
+	void testAppendsToOutput() {
+		const byte prefix[]{ byte{ 9 }, byte{ 8 } };
+		std::mt19937 rng{ 2u };
+		const std::vector<byte> data{ makeData(200000u, rng) };
+		for (const size_t threads : { 1u, 3u }) {
+			std::vector<byte> out(std::begin(prefix), std::end(prefix));
+			{
+				CompressionStream stream{ out, { CompressionFormat::Zlib, 6, threads, 1u << 16u } };
+				stream.write(data.data(), data.size());
+				stream.finish();
+			}
+			CHECK(out[0] == prefix[0] && out[1] == prefix[1]);
+			CHECK(decompressData(out.data() + 2u, out.size() - 2u) == data);
+
+			//Data appended after finish survives the destruction of the stream.
+			std::vector<byte> appended;
+			{
+				CompressionStream stream{ appended, { CompressionFormat::GZip, 6, threads, 1u << 16u } };
+				stream.write(data.data(), data.size());
+				stream.finish();
+				appended.insert(appended.end(), std::begin(prefix), std::end(prefix));
+			}
+			CHECK(appended.size() > 2u && appended[appended.size() - 2u] == prefix[0] && appended.back() == prefix[1]);
+			CHECK(decompressData(appended.data(), appended.size() - 2u) == data);
+		}
+	}
+
+	void testCompressedDocuments() {
+		std::pmr::monotonic_buffer_resource arena;
+		Compound_Tag root("", &arena);
+		NBT_LibTest::fillSampleDocument(root);
+		std::vector<int64_t> longs(200000u);
+		for (size_t i = 0u; i < longs.size(); ++i)
+			longs[i] = int64_t(i % 1000u);
+		root.emplaceArray<LongArray_Tag>("bigLongs", longs);
+		const std::vector<byte> encoded{ buildBinaryNBTFile(&root) };
+
+		for (const size_t threads : { 1u, 3u }) {
+			const std::vector<byte> compressed{ buildCompressedNBTFile(&root, { CompressionFormat::GZip, 6, threads }) };
+			CHECK(isCompressed(compressed.data(), compressed.size()));
+			CHECK(decompressData(compressed.data(), compressed.size()) == encoded);
+
+			//An NBT_Writer feeding a CompressionStream produces the same document.
+			std::vector<byte> streamed;
+			CompressionStream stream{ streamed, { CompressionFormat::Zlib, 6, threads } };
+			NBT_Writer writer{ [&](const byte* data, size_t size) { stream.write(data, size); } };
+			writer.beginCompound("");
+			writer.writeLongArray("bigLongs", longs);
+			writer.end();
+			writer.finish();
+			stream.finish();
+
+			Compound_Tag expected("", &arena);
+			expected.emplaceArray<LongArray_Tag>("bigLongs", longs);
+			CHECK(decompressData(streamed.data(), streamed.size()) == buildBinaryNBTFile(&expected));
+		}
+	}
+}
+
+int main() {
+	testThreadedMatchesSingleThreaded();
+	testAppendsToOutput();
+	testCompressedDocuments();
+	return NBT_LibTest::testResult();
+}
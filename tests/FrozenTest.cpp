@@ -0,0 +1,45 @@
+#include <string>
+#include <memory_resource>
+
+#include "TestUtil.h"
+#include "NBT_Lib.h"
+#include "NBT_LibFrozen.h"
+
+using namespace NBT_Lib;
+
+namespace {
+	void testLookups() {
+		std::pmr::monotonic_buffer_resource arena;
+		Compound_Tag root{ "", &arena };
+		NBT_LibTest::fillSampleDocument(root);
+		const FrozenNBT frozen{ freeze(root) };
+		const FrozenTag frozenRoot{ frozen.getRoot() };
+
+		CHECK(frozenRoot.size() == root.values.size());
+		CHECK(frozenRoot.find("int").getValue<int32_t>() == 123456789);
+		CHECK(frozenRoot.find("string").getString() == "caf\xc3\xa9 \xf0\x9f\x98\x80");
+		CHECK(frozenRoot.find("longs").getArray<int64_t>().size() == 2u);
+		CHECK(frozenRoot.find("entities")[1].find("id").getString() == "minecraft:zombie");
+		CHECK(frozenRoot.find("data").find("player").find("level").getValue<int32_t>() == 30);
+		CHECK(!frozenRoot.find("missing"));
+		CHECK_THROWS(frozenRoot.find("int").getValue<int64_t>(), std::runtime_error);
+		CHECK_THROWS(frozenRoot.find("pos")[3], std::out_of_range);
+	}
+
+	void testLongNames() {
+		std::pmr::monotonic_buffer_resource arena;
+		Compound_Tag root{ "", &arena };
+		const std::string longest(UINT16_MAX, 'n');
+		root.emplace<Int_Tag>(longest, 1);
+		CHECK(freeze(root).getRoot().find(longest).getName().size() == UINT16_MAX);
+
+		root.emplace<Compound_Tag>("nested").emplace<Int_Tag>(std::string(UINT16_MAX + 1u, 'n'), 2);
+		CHECK_THROWS(freeze(root), std::length_error);
+	}
+}
+
+int main() {
+	testLookups();
+	testLongNames();
+	return NBT_LibTest::testResult();
+}
@@ -0,0 +1,71 @@
+#include <memory_resource>
+
+#include "TestUtil.h"
+#include "NBT_Lib.h"
+#include "NBT_LibHash.h"
+
+using namespace NBT_Lib;
+using NBT_LibTest::RawDocument;
+
+namespace {
+	//Root compound holding an Int_Tag for each name and value, names may repeat.
+	Compound_Tag parseInts(std::initializer_list<std::pair<std::string_view, int32_t>> entries) {
+		RawDocument doc;
+		doc.tag(TagID::Compound, "");
+		for (const auto& [name, value] : entries)
+			doc.tag(TagID::Int, name).u32(static_cast<uint32_t>(value));
+		doc.u8(static_cast<uint8_t>(TagID::End));
+		return parseNBT(doc.data.data(), doc.data.size(), std::pmr::get_default_resource());
+	}
+
+	void testOrderInsensitive() {
+		const Compound_Tag a{ parseInts({ { "x", 1 }, { "y", 2 } }) };
+		const Compound_Tag b{ parseInts({ { "y", 2 }, { "x", 1 } }) };
+		CHECK(!tagsEqual(&a, &b));
+		CHECK(tagsEqual(&a, &b, true));
+		CHECK(hashTag(&a, { true }) == hashTag(&b, { true }));
+		CHECK(hashTag(&a) != hashTag(&b));
+	}
+
+	void testDuplicateNames() {
+		const Compound_Tag twice{ parseInts({ { "x", 1 }, { "x", 1 } }) };
+		const Compound_Tag distinct{ parseInts({ { "x", 1 }, { "y", 2 } }) };
+		CHECK(!tagsEqual(&twice, &distinct, true));
+		CHECK(!tagsEqual(&distinct, &twice, true));
+
+		const Compound_Tag a{ parseInts({ { "x", 1 }, { "x", 2 }, { "y", 3 } }) };
+		const Compound_Tag b{ parseInts({ { "y", 3 }, { "x", 2 }, { "x", 1 } }) };
+		const Compound_Tag c{ parseInts({ { "x", 2 }, { "x", 2 }, { "y", 3 } }) };
+		CHECK(tagsEqual(&a, &b, true));
+		CHECK(hashTag(&a, { true }) == hashTag(&b, { true }));
+		CHECK(!tagsEqual(&a, &c, true));
+		CHECK(!tagsEqual(&c, &a, true));
+	}
+
+	void testCache() {
+		Compound_Tag root{ std::string_view{}, std::pmr::get_default_resource() };
+		NBT_LibTest::fillSampleDocument(root);
+		Compound_Tag copy{ root, std::pmr::get_default_resource() };
+
+		TagHashCache cache;
+		CHECK(cache.hash(&root) == hashTag(&root));
+		CHECK(cache.equal(&root, &copy));
+
+		//Changing a tag requires invalidating every compound containing it.
+		Compound_Tag* data{ static_cast<Compound_Tag*>(copy.values[copy.indexMap.at("data")]) };
+		Compound_Tag* player{ static_cast<Compound_Tag*>(data->values[0]) };
+		static_cast<Int_Tag*>(player->values[0])->value = 31;
+		cache.invalidate(player);
+		cache.invalidate(data);
+		cache.invalidate(&copy);
+		CHECK(!cache.equal(&root, &copy));
+		CHECK(cache.hash(&copy) == hashTag(&copy));
+	}
+}
+
+int main() {
+	testOrderInsensitive();
+	testDuplicateNames();
+	testCache();
+	return NBT_LibTest::testResult();
+}
@@ -0,0 +1,204 @@
+#include <random>
+#include <memory_resource>
+
+#include "TestUtil.h"
+#include "NBT_Lib.h"
+#include "NBT_LibHash.h"
+#include "NBT_LibValidate.h"
+#include "NBT_LibWriter.h"
+
+using namespace NBT_Lib;
+using namespace std::literals;
+
+namespace {
+	//Java's Modified UTF-8 encoding of UTF-16 code units.
+	std::string javaMUTF8(const std::vector<uint16_t>& units) {
+		std::string out;
+		for (const uint16_t unit : units) {
+			if (unit != 0u && unit < 0x80u) {
+				out += char(unit);
+			}
+			else if (unit < 0x800u) {
+				out += char(0xc0u | (unit >> 6u));
+				out += char(0x80u | (unit & 0x3fu));
+			}
+			else {
+				out += char(0xe0u | (unit >> 12u));
+				out += char(0x80u | ((unit >> 6u) & 0x3fu));
+				out += char(0x80u | (unit & 0x3fu));
+			}
+		}
+		return out;
+	}
+
+	//UTF-8 form of UTF-16 code units, unpaired surrogates are kept as 3 byte sequences.
+	std::string expectedUTF8(const std::vector<uint16_t>& units) {
+		std::string out;
+		const auto put{ [&](uint32_t c) {
+			if (c < 0x80u) {
+				out += char(c);
+			}
+			else if (c < 0x800u) {
+				out += char(0xc0u | (c >> 6u));
+				out += char(0x80u | (c & 0x3fu));
+			}
+			else if (c < 0x10000u) {
+				out += char(0xe0u | (c >> 12u));
+				out += char(0x80u | ((c >> 6u) & 0x3fu));
+				out += char(0x80u | (c & 0x3fu));
+			}
+			else {
+				out += char(0xf0u | (c >> 18u));
+				out += char(0x80u | ((c >> 12u) & 0x3fu));
+				out += char(0x80u | ((c >> 6u) & 0x3fu));
+				out += char(0x80u | (c & 0x3fu));
+			}
+		} };
+		for (size_t i = 0u; i < units.size(); ++i) {
+			const uint16_t unit{ units[i] };
+			if (unit >= 0xd800u && unit <= 0xdbffu && i + 1u < units.size() && units[i + 1u] >= 0xdc00u && units[i + 1u] <= 0xdfffu) {
+				put(0x10000u + ((unit - 0xd800u) << 10u) + (units[i + 1u] - 0xdc00u));
+				++i;
+			}
+			else {
+				put(unit);
+			}
+		}
+		return out;
+	}
+
+	//Document holding a single string entry with the given encoded name and value.
+	std::vector<byte> stringDocument(std::string_view encodedName, std::string_view encodedValue) {
+		NBT_LibTest::RawDocument doc;
+		doc.tag(TagID::Compound, "").tag(TagID::String, encodedName).u16(static_cast<uint16_t>(encodedValue.size())).bytes(encodedValue).u8(0u);
+		return doc.data;
+	}
+
+	std::vector<byte> encodeString(std::string_view value, std::pmr::memory_resource* memRes) {
+		Compound_Tag root("", memRes);
+		root.emplace<String_Tag>("s", value);
+		return buildBinaryNBTFile(&root);
+	}
+
+	void testRoundTrips() {
+		std::mt19937 rng{ 42u };
+		std::pmr::monotonic_buffer_resource arena;
+		for (int iteration = 0; iteration < 5000; ++iteration) {
+			std::vector<uint16_t> units;
+			const size_t count{ rng() % 60u };
+			for (size_t i = 0u; i < count; ++i) {
+				switch (rng() % 8u) {
+				case 0u:
+					units.push_back(0u);
+					break;
+				case 1u: //Pair encoding a supplementary character.
+					units.push_back(uint16_t(0xd800u + rng() % 0x400u));
+					units.push_back(uint16_t(0xdc00u + rng() % 0x400u));
+					break;
+				case 2u: //Surrogate that is most likely unpaired.
+					units.push_back(uint16_t(0xd800u + rng() % 0x800u));
+					break;
+				case 3u:
+					units.push_back(uint16_t(0x80u + rng() % 0x780u));
+					break;
+				case 4u:
+					units.push_back(uint16_t(0x800u + rng() % 0xf800u));
+					break;
+				default:
+					units.push_back(uint16_t(0x20u + rng() % 0x5fu));
+					break;
+				}
+			}
+
+			const std::string encoded{ javaMUTF8(units) };
+			const std::string utf8{ expectedUTF8(units) };
+			std::vector<byte> document{ stringDocument(encoded, encoded) };
+			CHECK(validateNBT(document.data(), document.size()));
+
+			Compound_Tag root{ parseNBT(document.data(), document.size(), &arena) };
+			const String_Tag* str{ static_cast<const String_Tag*>(root.values.at(0)) };
+			CHECK(std::string_view{ str->name } == utf8);
+			CHECK(std::string_view{ str->value } == utf8);
+			CHECK(buildBinaryNBTFile(&root) == document);
+			CHECK(hashTag(&root) == hashRawNBT(document.data(), document.size()));
+		}
+	}
+
+	void testInvalidMUTF8() {
+		std::pmr::monotonic_buffer_resource arena;
+		//4 byte sequences, stray continuation bytes, truncated sequences and overlong forms other than the encoded NUL.
+		for (const std::string_view invalid : { "\xf0\x9f\x98\x80"sv, "\x80"sv, "a\xc3"sv, "\xc0\x81"sv, "\xc1\xbf"sv, "\xe0\x80\x80"sv, "\xe2\x82"sv, "\xff"sv }) {
+			std::vector<byte> asValue{ stringDocument("k", invalid) };
+			CHECK(!validateNBT(asValue.data(), asValue.size()));
+			CHECK_THROWS(parseNBT(asValue.data(), asValue.size(), &arena), std::runtime_error);
+
+			std::vector<byte> asName{ stringDocument(invalid, "v") };
+			CHECK(!validateNBT(asName.data(), asName.size()));
+			CHECK_THROWS(parseNBT(asName.data(), asName.size(), &arena), std::runtime_error);
+		}
+	}
+
+	void testInvalidUTF8() {
+		std::pmr::monotonic_buffer_resource arena;
+		//Latin-1, stray continuation bytes, overlong forms, truncated sequences and bytes that never occur in UTF-8.
+		for (const std::string_view invalid : { "caf\xe9"sv, "\x80"sv, "a\xbf"sv, "\xc0\x80"sv, "\xc1\xbf"sv, "\xe0\x80\x80"sv, "\xe2\x82"sv, "\xe2\x82x"sv,
+			"\xf0\x8f\xbf\xbf"sv, "\xf4\x90\x80\x80"sv, "\xf5\x80\x80\x80"sv, "\xff"sv }) {
+			CHECK_THROWS(encodeString(invalid, &arena), std::runtime_error);
+
+			std::vector<byte> out;
+			NBT_Writer writer{ out };
+			writer.beginCompound("");
+			CHECK_THROWS(writer.writeString("s", invalid), std::runtime_error);
+
+			//Hashing works on strings that can not be encoded.
+			String_Tag str("", std::string{ invalid }, &arena);
+			CHECK(hashTag(&str) == hashTag(&str));
+		}
+		//A conversion that would be needed before the invalid sequence must not be applied to it.
+		String_Tag nulThenInvalid("", std::string(40u, '\0') + "\xf0", &arena);
+		CHECK(hashTag(&nulThenInvalid) == hashTag(&nulThenInvalid));
+
+		for (const std::string_view valid : { "caf\xc3\xa9"sv, "\xe2\x82\xac"sv, "\xed\xa0\x80"sv, "\xed\x9f\xbf"sv, "\xe0\xa0\x80"sv, "\xf0\x9f\x98\x80"sv, "a\0b"sv })
+			CHECK_NOTHROW(encodeString(valid, &arena));
+
+		//Whatever is encoded can be parsed again.
+		std::mt19937 rng{ 5u };
+		for (int iteration = 0; iteration < 20000; ++iteration) {
+			std::string value(rng() % 12u, '\0');
+			for (char& c : value) {
+				const uint32_t r{ static_cast<uint32_t>(rng()) };
+				c = char((r & 3u) == 0u ? (r >> 8u) & 0x7fu : 0x80u | ((r >> 8u) & 0x7fu));
+			}
+			std::vector<byte> document;
+			try {
+				document = encodeString(value, &arena);
+			}
+			catch (const std::runtime_error&) {
+				continue;
+			}
+			CHECK_NOTHROW(parseNBT(document.data(), document.size(), &arena));
+		}
+	}
+
+	void testLongStrings() {
+		std::pmr::monotonic_buffer_resource arena;
+		std::string longValue(60000u, 'x');
+		longValue[100] = '\xc3';
+		longValue[101] = '\xa9';
+		std::vector<byte> document{ stringDocument("long", longValue) };
+		Compound_Tag root{ parseNBT(document.data(), document.size(), &arena) };
+		CHECK(static_cast<const String_Tag*>(root.values.at(0))->value.size() == 60000u);
+		CHECK(buildBinaryNBTFile(&root) == document);
+
+		//65535 NULs take 131070 bytes once encoded.
+		CHECK_THROWS(encodeString(std::string(65535u, '\0'), &arena), std::runtime_error);
+	}
+}
+
+int main() {
+	testRoundTrips();
+	testInvalidMUTF8();
+	testInvalidUTF8();
+	testLongStrings();
+	return NBT_LibTest::testResult();
+}
@@ -0,0 +1,163 @@
+#include <random>
+#include <memory_resource>
+#include <filesystem>
+
+#include "TestUtil.h"
+#include "NBT_Lib.h"
+#include "NBT_LibHash.h"
+#include "NBT_LibRegion.h"
+
+using namespace NBT_Lib;
+namespace fs = std::filesystem;
+
+namespace {
+	struct RegionTest {
+		fs::path directory{ fs::temp_directory_path() / "NBT_LibRegionTest" };
+		std::pmr::monotonic_buffer_resource arena;
+		std::vector<Compound_Tag> roots;
+
+		RegionTest() {
+			fs::remove_all(directory);
+			fs::create_directories(directory);
+
+			roots.reserve(64u);
+			for (int i = 0; i < 63; ++i) {
+				Compound_Tag& root{ roots.emplace_back("", &arena) };
+				NBT_LibTest::fillSampleDocument(root);
+				root.emplace<Int_Tag>("xPos", i);
+				//Chunks of different sizes, so updated chunks move around.
+				std::vector<int32_t> filler(size_t(i % 5) * 3000u);
+				for (size_t j = 0u; j < filler.size(); ++j)
+					filler[j] = int32_t(j * 2654435761u >> (i % 7));
+				root.emplaceArray<IntArray_Tag>("filler", filler);
+			}
+			//Too large for 255 sectors even when compressed, stored in an external file.
+			Compound_Tag& big{ roots.emplace_back("", &arena) };
+			std::vector<int32_t> noise(400000u);
+			std::mt19937 rng{ 1u };
+			for (int32_t& value : noise)
+				value = int32_t(rng());
+			big.emplaceArray<IntArray_Tag>("noise", noise);
+		}
+		~RegionTest() {
+			std::error_code error;
+			fs::remove_all(directory, error);
+		}
+
+		const Compound_Tag* bigRoot() const {
+			return &roots.back();
+		}
+
+		//Checks that the region holds exactly the expected chunks and that no two chunks share a sector.
+		void checkRegion(const fs::path& path, const std::vector<const Compound_Tag*>& expected) {
+			const RegionReader reader{ path };
+			std::vector<bool> usedSectors(reader.getFileSize() / REGION_SECTOR_SIZE + 256u, false);
+			for (size_t i = 0u; i < REGION_CHUNK_COUNT; ++i) {
+				std::vector<byte> data;
+				const bool present{ reader.readChunk(i, data) };
+				CHECK(present == (expected[i] != nullptr));
+				if (present && expected[i])
+					CHECK(hashRawNBT(data.data(), data.size()) == hashTag(expected[i]));
+
+				const RegionChunkLocation& location{ reader.getLocation(i) };
+				if (!location.exists())
+					continue;
+				CHECK(location.sectorOffset >= 2u);
+				for (size_t sector = location.sectorOffset; sector < size_t(location.sectorOffset) + location.sectorCount; ++sector) {
+					CHECK(sector < usedSectors.size() && !usedSectors[sector]);
+					if (sector < usedSectors.size())
+						usedSectors[sector] = true;
+				}
+			}
+			CHECK(reader.getFileSize() % REGION_SECTOR_SIZE == 0u);
+		}
+	};
+
+	void testWriteAndUpdate() {
+		RegionTest test;
+		const fs::path path{ test.directory / "r.0.0.mca" };
+		std::vector<const Compound_Tag*> expected(REGION_CHUNK_COUNT, nullptr);
+
+		std::vector<RegionChunkWrite> writes;
+		for (size_t i = 0u; i + 1u < test.roots.size(); ++i) {
+			const size_t chunkIndex{ i * 13u % REGION_CHUNK_COUNT };
+			writes.push_back({ chunkIndex, &test.roots[i], 1000u });
+			expected[chunkIndex] = &test.roots[i];
+		}
+		writeRegionFile(path, writes);
+		test.checkRegion(path, expected);
+		CHECK(RegionReader{ path }.getLocation(13u).timestamp == 1000u);
+
+		//Remove a chunk, move one into an external file, grow and shrink others and add a new one.
+		std::vector<RegionChunkWrite> updates{ { 0u, nullptr }, { 13u, test.bigRoot() }, { 26u, &test.roots[4] }, { 39u, &test.roots[5] }, { 1000u, &test.roots[9] } };
+		updateRegionFile(path, updates, { .threadCount = 4u });
+		expected[0] = nullptr;
+		expected[13] = test.bigRoot();
+		expected[26] = &test.roots[4];
+		expected[39] = &test.roots[5];
+		expected[1000] = &test.roots[9];
+		test.checkRegion(path, expected);
+		CHECK(fs::exists(test.directory / "c.13.0.mcc"));
+
+		//Moving the chunk back into the region removes its external file.
+		updates = { { 13u, &test.roots[1] } };
+		updateRegionFile(path, updates, { .compression = ChunkCompression::GZip });
+		expected[13] = &test.roots[1];
+		test.checkRegion(path, expected);
+		CHECK(!fs::exists(test.directory / "c.13.0.mcc"));
+
+		//Removing the chunks at the end of the file truncates it.
+		const uintmax_t sizeBefore{ fs::file_size(path) };
+		updates.clear();
+		for (size_t i = 0u; i < REGION_CHUNK_COUNT; ++i) {
+			if (expected[i] && i % 2u == 0u) {
+				updates.push_back({ i, nullptr });
+				expected[i] = nullptr;
+			}
+		}
+		updateRegionFile(path, updates, { .compression = ChunkCompression::None });
+		test.checkRegion(path, expected);
+		CHECK(fs::file_size(path) < sizeBefore);
+	}
+
+	void testCreateWithUpdate() {
+		RegionTest test;
+		const fs::path path{ test.directory / "r.-1.2.mca" };
+		std::vector<const Compound_Tag*> expected(REGION_CHUNK_COUNT, nullptr);
+		const RegionChunkWrite writes[]{ { 0u, &test.roots[0] }, { 2u, &test.roots[2] }, { 1023u, test.bigRoot() } };
+		updateRegionFile(path, writes, { .compression = ChunkCompression::GZip });
+		expected[0] = &test.roots[0];
+		expected[2] = &test.roots[2];
+		expected[1023] = test.bigRoot();
+		test.checkRegion(path, expected);
+		CHECK(fs::exists(test.directory / "c.-1.95.mcc"));
+
+		//Writing a new file replaces all previous contents, including their external chunk files.
+		const RegionChunkWrite replacement[]{ { 0u, &test.roots[3] }, { 2u, &test.roots[2] } };
+		writeRegionFile(path, replacement);
+		expected[0] = &test.roots[3];
+		expected[1023] = nullptr;
+		test.checkRegion(path, expected);
+		CHECK(!fs::exists(test.directory / "c.-1.95.mcc"));
+		CHECK(!fs::exists(test.directory / "r.-1.2.mca.tmp"));
+	}
+
+	void testInvalidWrites() {
+		RegionTest test;
+		const fs::path path{ test.directory / "r.0.0.mca" };
+		const RegionChunkWrite outside[]{ { REGION_CHUNK_COUNT, &test.roots[0] } };
+		CHECK_THROWS(writeRegionFile(path, outside), std::out_of_range);
+		const RegionChunkWrite twice[]{ { 5u, &test.roots[0] }, { 5u, &test.roots[1] } };
+		CHECK_THROWS(writeRegionFile(path, twice), std::invalid_argument);
+		//External chunks need the region coordinates from the file name.
+		const RegionChunkWrite big[]{ { 5u, test.bigRoot() } };
+		CHECK_THROWS(writeRegionFile(test.directory / "region.mca", big), std::runtime_error);
+	}
+}
+
+int main() {
+	testWriteAndUpdate();
+	testCreateWithUpdate();
+	testInvalidWrites();
+	return NBT_LibTest::testResult();
+}
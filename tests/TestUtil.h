@@ -0,0 +1,122 @@
+#pragma once
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#include "NBT_Lib.h"
+
+//Minimal test helpers: failed checks are reported and counted, the test's main returns testResult().
+
+namespace NBT_LibTest {
+	inline size_t failedChecks{ 0u };
+
+	inline void reportFailure(const char* file, int line, const std::string& message) {
+		++failedChecks;
+		std::cerr << file << '(' << line << "): " << message << '\n';
+	}
+
+	inline int testResult() {
+		if (failedChecks == 0u) {
+			std::cout << "All checks passed.\n";
+			return 0;
+		}
+		std::cerr << failedChecks << " checks failed.\n";
+		return 1;
+	}
+
+	//Fills root with entries of every type, including nested lists and compounds.
+	inline void fillSampleDocument(NBT_Lib::Compound_Tag& root) {
+		using namespace NBT_Lib;
+		root.emplace<Byte_Tag>("byte", int8_t{ -3 });
+		root.emplace<Short_Tag>("short", int16_t{ 1234 });
+		root.emplace<Int_Tag>("int", 123456789);
+		root.emplace<Long_Tag>("long", int64_t{ -1234567890123 });
+		root.emplace<Float_Tag>("float", 1.5f);
+		root.emplace<Double_Tag>("double", -2.25);
+		root.emplace<String_Tag>("string", "caf\xc3\xa9 \xf0\x9f\x98\x80");
+		const int8_t bytes[]{ 1, 2, 3, -4 };
+		root.emplaceArray<ByteArray_Tag>("bytes", bytes);
+		const int32_t ints[]{ 7, -8, 9 };
+		root.emplaceArray<IntArray_Tag>("ints", ints);
+		const int64_t longs[]{ 1ll << 40, -1 };
+		root.emplaceArray<LongArray_Tag>("longs", longs);
+		root.emplace<List_Tag>("empty", TagID::End);
+
+		List_Tag& doubles{ root.emplace<List_Tag>("pos", TagID::Double) };
+		doubles.emplace<Double_Tag>(1.0);
+		doubles.emplace<Double_Tag>(64.5);
+		doubles.emplace<Double_Tag>(-3.0);
+
+		List_Tag& entities{ root.emplace<List_Tag>("entities", TagID::Compound) };
+		for (int i = 0; i < 4; ++i) {
+			Compound_Tag& entity{ entities.emplace<Compound_Tag>() };
+			entity.emplace<String_Tag>("id", i % 2 == 0 ? "minecraft:pig" : "minecraft:zombie");
+			entity.emplace<Float_Tag>("health", 20.0f - float(i));
+			List_Tag& inventory{ entity.emplace<List_Tag>("inventory", TagID::Compound) };
+			inventory.emplace<Compound_Tag>().emplace<Byte_Tag>("count", int8_t(i));
+			List_Tag& nested{ entity.emplace<List_Tag>("nested", TagID::List) };
+			nested.emplace<List_Tag>(TagID::String).emplace<String_Tag>("deep");
+		}
+		root.emplace<Compound_Tag>("data").emplace<Compound_Tag>("player").emplace<Int_Tag>("level", 30);
+	}
+
+	//Builds encoded documents byte by byte.
+	struct RawDocument {
+		std::vector<NBT_Lib::byte> data;
+
+		RawDocument& u8(uint8_t value) {
+			data.push_back(static_cast<NBT_Lib::byte>(value));
+			return *this;
+		}
+		RawDocument& u16(uint16_t value) {
+			return u8(uint8_t(value >> 8u)).u8(uint8_t(value));
+		}
+		RawDocument& u32(uint32_t value) {
+			return u16(uint16_t(value >> 16u)).u16(uint16_t(value));
+		}
+		RawDocument& bytes(std::string_view str) {
+			for (const char c : str)
+				u8(static_cast<uint8_t>(c));
+			return *this;
+		}
+		//Tag header: id followed by the length and bytes of the name.
+		RawDocument& tag(NBT_Lib::TagID id, std::string_view name) {
+			return u8(static_cast<uint8_t>(id)).u16(static_cast<uint16_t>(name.size())).bytes(name);
+		}
+	};
+}
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) \
+			NBT_LibTest::reportFailure(__FILE__, __LINE__, "CHECK(" #condition ") failed."); \
+	} while (false)
+
+//Checks that expression throws exceptionType (or a type derived from it).
+#define CHECK_THROWS(expression, exceptionType) \
+	do { \
+		bool nbtLibTestThrew{ false }; \
+		try { \
+			(void)(expression); \
+		} \
+		catch (const exceptionType&) { \
+			nbtLibTestThrew = true; \
+		} \
+		catch (const std::exception& e) { \
+			NBT_LibTest::reportFailure(__FILE__, __LINE__, "CHECK_THROWS(" #expression ") threw another exception: " + std::string{ e.what() }); \
+			nbtLibTestThrew = true; \
+		} \
+		if (!nbtLibTestThrew) \
+			NBT_LibTest::reportFailure(__FILE__, __LINE__, "CHECK_THROWS(" #expression ") did not throw " #exceptionType "."); \
+	} while (false)
+
+#define CHECK_NOTHROW(expression) \
+	do { \
+		try { \
+			(void)(expression); \
+		} \
+		catch (const std::exception& e) { \
+			NBT_LibTest::reportFailure(__FILE__, __LINE__, "CHECK_NOTHROW(" #expression ") threw: " + std::string{ e.what() }); \
+		} \
+	} while (false)
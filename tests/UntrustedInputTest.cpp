@@ -0,0 +1,169 @@
+#include <random>
+#include <span>
+#include <memory_resource>
+
+#include "TestUtil.h"
+#include "NBT_Lib.h"
+#include "NBT_LibColumns.h"
+#include "NBT_LibHash.h"
+#include "NBT_LibMemory.h"
+#include "NBT_LibPatch.h"
+#include "NBT_LibValidate.h"
+
+using namespace NBT_Lib;
+using NBT_LibTest::RawDocument;
+
+namespace {
+	//Runs every decoder on data, which may be malformed. Decoders must either succeed or throw, and whatever validates must parse.
+	//parseNBT is more lenient than validateNBT in one case: it accepts a root compound ending with the data instead of a TAG_End.
+	void decodeEverywhere(std::vector<byte> data) {
+		std::pmr::monotonic_buffer_resource arena;
+		BudgetMemoryResource budget{ SIZE_MAX, &arena };
+		const bool valid{ validateNBT(data.data(), data.size()) };
+
+		bool parsed{ false };
+		try {
+			Compound_Tag root{ parseNBT(data.data(), data.size(), &budget) };
+			parsed = true;
+			CHECK(hashTag(&root) == hashRawNBT(data.data(), data.size()));
+		}
+		catch (const std::exception&) {
+		}
+		CHECK(parsed || !valid);
+		CHECK(parsed || budget.getUsed() == 0u);
+
+		try {
+			(void)hashRawNBT(data.data(), data.size());
+		}
+		catch (const std::exception&) {
+		}
+		for (const std::string_view path : { "int", "entities[3].inventory[0].count", "data.player.level", "string", "missing" }) {
+			try {
+				(void)findRawTag(data.data(), data.size(), path);
+			}
+			catch (const std::exception&) {
+			}
+		}
+
+		//The document is copied into a buffer of its exact size, so reading past it is detected by sanitizers.
+		const std::span<const byte> document{ data };
+		NBT_ColumnExtractor extractor{ { { "id", TagID::String }, { "health", TagID::Float }, { "inventory[0].count", TagID::Byte } }, "entities" };
+		const NBT_ColumnBatch batch{ extractor.extract(std::span{ &document, 1u }, 1u) };
+		CHECK(batch.failedDocuments.empty() || !valid);
+	}
+
+	std::vector<byte> sampleDocument() {
+		std::pmr::monotonic_buffer_resource arena;
+		Compound_Tag root("", &arena);
+		NBT_LibTest::fillSampleDocument(root);
+		return buildBinaryNBTFile(&root);
+	}
+
+	void testTruncated() {
+		const std::vector<byte> document{ sampleDocument() };
+		decodeEverywhere(document);
+		for (size_t size = 0u; size < document.size(); ++size) {
+			std::vector<byte> truncated(document.begin(), document.begin() + size);
+			CHECK(!validateNBT(truncated.data(), truncated.size()));
+			decodeEverywhere(std::move(truncated));
+		}
+	}
+
+	void testCorrupted() {
+		const std::vector<byte> document{ sampleDocument() };
+		std::mt19937 rng{ 7u };
+		for (int iteration = 0; iteration < 3000; ++iteration) {
+			std::vector<byte> corrupted{ document };
+			const size_t changes{ 1u + rng() % 3u };
+			for (size_t i = 0u; i < changes; ++i)
+				corrupted[rng() % corrupted.size()] = static_cast<byte>(rng());
+			decodeEverywhere(std::move(corrupted));
+		}
+	}
+
+	void testMaliciousLengths() {
+		std::pmr::monotonic_buffer_resource arena;
+
+		//Lists of TAG_End can not have elements, their count is not limited by the size of the data.
+		RawDocument endList;
+		endList.tag(TagID::Compound, "").tag(TagID::List, "l").u8(0u).u32(INT32_MAX).u8(0u);
+		CHECK(!validateNBT(endList.data.data(), endList.data.size()));
+		CHECK_THROWS(parseNBT(endList.data.data(), endList.data.size(), &arena), std::runtime_error);
+		CHECK_THROWS(findRawTag(endList.data.data(), endList.data.size(), "x"), std::runtime_error);
+		CHECK_THROWS(findRawTag(endList.data.data(), endList.data.size(), "l[5]"), std::runtime_error);
+		CHECK_THROWS(rawPayloadSize(endList.data.data() + 7u, endList.data.size() - 7u, TagID::List), std::runtime_error);
+		decodeEverywhere(endList.data);
+
+		//Empty lists of TAG_End are valid.
+		RawDocument emptyEndList;
+		emptyEndList.tag(TagID::Compound, "").tag(TagID::List, "l").u8(0u).u32(0u).tag(TagID::Int, "i").u32(7u).u8(0u);
+		CHECK(validateNBT(emptyEndList.data.data(), emptyEndList.data.size()));
+		CHECK(findRawTag(emptyEndList.data.data(), emptyEndList.data.size(), "i").type == TagID::Int);
+		CHECK(findRawTag(emptyEndList.data.data(), emptyEndList.data.size(), "l").count == 0u);
+
+		//Counts far larger than the data must be rejected before anything is allocated for them.
+		for (const TagID arrayType : { TagID::Byte_Array, TagID::Int_Array, TagID::Long_Array }) {
+			RawDocument hugeArray;
+			hugeArray.tag(TagID::Compound, "").tag(arrayType, "a").u32(INT32_MAX).u32(0u).u8(0u);
+			BudgetMemoryResource budget{ 1u << 20u, &arena };
+			CHECK_THROWS(parseNBT(hugeArray.data.data(), hugeArray.data.size(), &budget), std::out_of_range);
+			decodeEverywhere(hugeArray.data);
+		}
+		RawDocument hugeList;
+		hugeList.tag(TagID::Compound, "").tag(TagID::List, "l").u8(static_cast<uint8_t>(TagID::Compound)).u32(INT32_MAX).u8(0u).u8(0u);
+		decodeEverywhere(hugeList.data);
+
+		RawDocument negative;
+		negative.tag(TagID::Compound, "").tag(TagID::Int_Array, "a").u32(0xffffffffu).u8(0u);
+		CHECK_THROWS(parseNBT(negative.data.data(), negative.data.size(), &arena), std::runtime_error);
+		decodeEverywhere(negative.data);
+
+		//String entries cut off inside their length or characters.
+		for (const size_t keep : { 8u, 9u, 12u }) {
+			RawDocument str;
+			str.tag(TagID::Compound, "").tag(TagID::String, "id").u16(3u).bytes("abc").u8(0u);
+			str.data.resize(keep);
+			CHECK_THROWS(findRawTag(str.data.data(), str.data.size(), "id"), std::out_of_range);
+
+			const std::span<const byte> document{ str.data };
+			const NBT_ColumnBatch batch{ NBT_ColumnExtractor{ { { "id", TagID::String } } }.extract(std::span{ &document, 1u }, 1u) };
+			CHECK(batch.rowCount() == 0u && batch.failedDocuments.size() == 1u);
+		}
+	}
+
+	void testDeepNesting() {
+		RawDocument deepCompounds;
+		deepCompounds.tag(TagID::Compound, "");
+		for (size_t i = 0u; i < NBT_MAX_DEPTH + 10u; ++i)
+			deepCompounds.tag(TagID::Compound, "");
+		CHECK(!validateNBT(deepCompounds.data.data(), deepCompounds.data.size()));
+		CHECK_THROWS(findRawTag(deepCompounds.data.data(), deepCompounds.data.size(), "x"), std::runtime_error);
+		CHECK_THROWS(parseNBT(deepCompounds.data.data(), deepCompounds.data.size(), std::pmr::get_default_resource()), std::runtime_error);
+
+		RawDocument deepLists;
+		deepLists.tag(TagID::Compound, "").tag(TagID::List, "l");
+		for (size_t i = 0u; i < NBT_MAX_DEPTH + 10u; ++i)
+			deepLists.u8(static_cast<uint8_t>(TagID::List)).u32(1u);
+		CHECK(!validateNBT(deepLists.data.data(), deepLists.data.size()));
+		CHECK_THROWS(findRawTag(deepLists.data.data(), deepLists.data.size(), "x"), std::runtime_error);
+		CHECK_THROWS(parseNBT(deepLists.data.data(), deepLists.data.size(), std::pmr::get_default_resource()), std::runtime_error);
+
+		//Exactly NBT_MAX_DEPTH levels, including the root compound, are still accepted.
+		RawDocument deepest;
+		deepest.tag(TagID::Compound, "");
+		for (size_t i = 1u; i < NBT_MAX_DEPTH; ++i)
+			deepest.tag(TagID::Compound, "");
+		for (size_t i = 0u; i < NBT_MAX_DEPTH; ++i)
+			deepest.u8(static_cast<uint8_t>(TagID::End));
+		CHECK(validateNBT(deepest.data.data(), deepest.data.size()));
+		CHECK_NOTHROW(parseNBT(deepest.data.data(), deepest.data.size(), std::pmr::get_default_resource()));
+	}
+}
+
+int main() {
+	testTruncated();
+	testCorrupted();
+	testMaliciousLengths();
+	testDeepNesting();
+	return NBT_LibTest::testResult();
+}